@@ -10,16 +10,26 @@ CONFIG += c++17
 
 SOURCES += \
     customshadoweffect.cpp \
+    lazytile.cpp \
     main.cpp \
     mainwindow.cpp \
     qtilelayout.cpp \
-    tile.cpp
+    tileindex.cpp \
+    tilejournal.cpp \
+    tileminimap.cpp \
+    tileoverlay.cpp
 
 HEADERS += \
     customshadoweffect.h \
+    lazytile.h \
     mainwindow.h \
+    placementchange.h \
     qtilelayout.h \
-    tile.h
+    tileindex.h \
+    tilejournal.h \
+    tileminimap.h \
+    tileoverlay.h \
+    tilesnapshot.h
 
 FORMS += \
     mainwindow.ui
@@ -1,5 +1,6 @@
 #include "customshadoweffect.h"
 #include <QPainter>
+#include <QtMath>
 // #include <QGraphicsEffect>
 
 CustomShadowEffect::CustomShadowEffect(QObject *parent) :
@@ -34,6 +35,41 @@ void CustomShadowEffect::draw(QPainter* painter)
     QTransform restoreTransform = painter->worldTransform();
     painter->setWorldTransform(QTransform());
 
+    // draw the blurred shadow...
+    painter->drawImage(offset, shadowImage(px));
+
+    // draw the actual pixmap...
+    painter->drawPixmap(offset, px, QRectF());
+
+    // restore world transform
+    painter->setWorldTransform(restoreTransform);
+}
+
+// Returns the source with the shadow drawn around it, without installing the effect on
+// a widget: a graphics effect forces the widget to be rendered off screen
+QPixmap CustomShadowEffect::shadowed(const QPixmap& source) const
+{
+    int delta = qCeil(blurRadius() + distance());
+    QPixmap result(source.size() + QSize(2 * delta, 2 * delta));
+    result.fill(Qt::transparent);
+
+    QPixmap padded(result.size());
+    padded.fill(Qt::transparent);
+    QPainter paddedPainter(&padded);
+    paddedPainter.drawPixmap(delta, delta, source);
+    paddedPainter.end();
+
+    QPainter painter(&result);
+    painter.drawImage(0, 0, shadowImage(padded));
+    painter.drawPixmap(delta, delta, source);
+    painter.end();
+
+    return result;
+}
+
+// Returns the blurred and coloured shadow of the pixmap
+QImage CustomShadowEffect::shadowImage(const QPixmap& px) const
+{
     // Calculate size for the background image
     QSize szi(px.size().width() + 2 * distance(), px.size().height() + 2 * distance());
 
@@ -60,14 +96,7 @@ void CustomShadowEffect::draw(QPainter* painter)
     tmpPainter.fillRect(tmp.rect(), color());
     tmpPainter.end();
 
-    // draw the blurred shadow...
-    painter->drawImage(offset, tmp);
-
-    // draw the actual pixmap...
-    painter->drawPixmap(offset, px, QRectF());
-
-    // restore world transform
-    painter->setWorldTransform(restoreTransform);
+    return tmp;
 }
 
 QRectF CustomShadowEffect::boundingRectFor(const QRectF& rect) const
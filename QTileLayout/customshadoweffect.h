@@ -12,6 +12,7 @@ public:
 
     void draw(QPainter* painter);
     QRectF boundingRectFor(const QRectF& rect) const;
+    QPixmap shadowed(const QPixmap& source) const;
 
     inline void setDistance(qreal distance) { _distance = distance; updateBoundingRect(); }
     inline qreal distance() const { return _distance; }
@@ -23,6 +24,8 @@ public:
     inline QColor color() const { return _color; }
 
 private:
+    QImage shadowImage(const QPixmap& px) const;
+
     qreal  _distance;
     qreal  _blurRadius;
     QColor _color;
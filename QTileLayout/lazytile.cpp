@@ -0,0 +1,56 @@
+#include "lazytile.h"
+
+LazyTile::LazyTile(Factory factory, QWidget *parent)
+    : QWidget(parent), factory(std::move(factory))
+{
+}
+
+// Returns the widget of the tile, nullptr if it has not been created or has been released
+QWidget *LazyTile::widget() const {
+    return content;
+}
+
+bool LazyTile::isMaterialized() const {
+    return content && !content->isHidden();
+}
+
+// Creates the widget if needed, or wakes it up if it was hibernated
+void LazyTile::materialize() {
+    if (isMaterialized()) {
+        return;
+    }
+
+    if (!content) {
+        content = factory ? factory() : nullptr;
+        if (!content) {
+            return;
+        }
+        // The widget has never been shown: taking it in is cheap
+        content->setParent(this);
+        content->setGeometry(rect());
+        content->show();
+        emit materialized(content);
+    } else {
+        content->setGeometry(rect());
+        content->show();
+    }
+}
+
+// Hides the widget, it keeps its state until it is materialized again
+void LazyTile::hibernate() {
+    if (content) {
+        content->hide();
+    }
+}
+
+// Deletes the widget, the factory creates a new one when it is materialized again
+void LazyTile::release() {
+    delete content.data();
+}
+
+void LazyTile::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    if (content) {
+        content->setGeometry(rect());
+    }
+}
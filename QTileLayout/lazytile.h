@@ -0,0 +1,37 @@
+#ifndef LAZYTILE_H
+#define LAZYTILE_H
+
+#include <QWidget>
+#include <QPointer>
+#include <QResizeEvent>
+#include <functional>
+
+// Holds the area of a widget that is only created once it comes near the visible part of
+// the layout. The factory is called at that time, the widget it returns fills the tile.
+// The widget can later be hibernated (hidden) or released (deleted, created again if needed)
+class LazyTile : public QWidget {
+    Q_OBJECT
+
+public:
+    using Factory = std::function<QWidget*()>;
+
+    explicit LazyTile(Factory factory, QWidget *parent = nullptr);
+
+    QWidget *widget() const;
+    bool isMaterialized() const;
+    void materialize();
+    void hibernate();
+    void release();
+
+signals:
+    void materialized(QWidget *widget);
+
+protected:
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    Factory factory;
+    QPointer<QWidget> content;
+};
+
+#endif // LAZYTILE_H
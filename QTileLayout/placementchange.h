@@ -0,0 +1,19 @@
+#ifndef PLACEMENTCHANGE_H
+#define PLACEMENTCHANGE_H
+
+#include <QWidget>
+#include <QRect>
+#include <QMetaType>
+
+// A change of placement of one widget. Rects are in cells: x is the column, y the row,
+// width the column span and height the row span. A null rect means that the widget
+// is not in the layout (before being added or after being removed)
+struct PlacementChange {
+    QWidget *widget = nullptr;
+    QRect from;
+    QRect to;
+};
+
+Q_DECLARE_METATYPE(PlacementChange)
+
+#endif // PLACEMENTCHANGE_H
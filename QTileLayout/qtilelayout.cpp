@@ -1,28 +1,236 @@
  #include "qtilelayout.h"
+#include "customshadoweffect.h"
 #include "qdebug.h"
+#include <QApplication>
+#include <QtMath>
+#include <QSet>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <type_traits>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+// Hands the undo steps of a layout over to a QUndoStack
+class TileUndoCommand : public QUndoCommand {
+
+public:
+    TileUndoCommand(QTileLayout *tileLayout, QObject *history, quint64 link)
+        : QUndoCommand(QCoreApplication::translate("QTileLayout", "Tile layout change")),
+        tileLayout(tileLayout), history(history), link(link), pushed(false)
+    {
+    }
+
+    // The linked layouts replay a shared step together, it is pushed once
+    quint64 stepLink() const {
+        return link;
+    }
+
+    // A command of a history the layout has cleared since does nothing, and the stack drops it
+    void undo() override {
+        if (tileLayout && history) {
+            tileLayout->undo();
+        } else {
+            setObsolete(true);
+        }
+    }
+
+    void redo() override {
+        // The change is already applied when the command is pushed
+        if (pushed && tileLayout && history) {
+            tileLayout->redo();
+        } else if (pushed) {
+            setObsolete(true);
+        }
+        pushed = true;
+    }
+
+private:
+    QPointer<QTileLayout> tileLayout;
+    QPointer<QObject> history;      // deleted when the layout clears its history
+    quint64 link;
+    bool pushed;
+};
+
+// Identifies the steps recorded by several layouts for the same operation
+quint64 newStepLink() {
+    static quint64 lastLink = 0;
+    return ++lastLink;
+}
+
+// The edge of an area a resize moves. The resize helpers are specialized per edge
+enum class Edge { West, East, North, South };
+
+template <Edge edge>
+using EdgeTag = std::integral_constant<Edge, edge>;
+
+// 1 if the edge moves towards the increasing coordinates to grow the area, -1 if not
+template <Edge edge>
+constexpr int outwards = (edge == Edge::East || edge == Edge::South) ? 1 : -1;
+
+template <Edge edge>
+constexpr bool horizontal = (edge == Edge::West || edge == Edge::East);
+
+// Calls visit with the edge pointed by the direction, known at compile time
+template <typename Visitor>
+auto visitEdge(QPoint direction, Visitor visit) {
+    if (direction.x() < 0) {
+        return visit(EdgeTag<Edge::West>());
+    } else if (direction.x() > 0) {
+        return visit(EdgeTag<Edge::East>());
+    } else if (direction.y() < 0) {
+        return visit(EdgeTag<Edge::North>());
+    }
+    return visit(EdgeTag<Edge::South>());
+}
+
+// Returns the area with its edge moved by offset cells along its axis
+template <Edge edge>
+QRect shiftedEdge(QRect area, int offset) {
+    if constexpr (edge == Edge::West) {
+        area.setLeft(area.left() + offset);
+    } else if constexpr (edge == Edge::East) {
+        area.setRight(area.right() + offset);
+    } else if constexpr (edge == Edge::North) {
+        area.setTop(area.top() + offset);
+    } else {
+        area.setBottom(area.bottom() + offset);
+    }
+    return area;
+}
+
+// Returns the strip of cells along the edge, just out of the area
+template <Edge edge>
+QRect outerStrip(const QRect &area) {
+    if constexpr (edge == Edge::West) {
+        return QRect(area.left() - 1, area.top(), 1, area.height());
+    } else if constexpr (edge == Edge::East) {
+        return QRect(area.right() + 1, area.top(), 1, area.height());
+    } else if constexpr (edge == Edge::North) {
+        return QRect(area.left(), area.top() - 1, area.width(), 1);
+    } else {
+        return QRect(area.left(), area.bottom() + 1, area.width(), 1);
+    }
+}
+
+// The values of a saved layout besides its placements, in the order they are applied:
+// a minimum size comes before the size
+const char *const LayoutValueKeys[] = {
+    "row_minimum_height", "column_minimum_width", "row_height", "column_width",
+    "vertical_spacing", "horizontal_spacing", "rows", "columns"
+};
+
+// Occupancy of the cells during a flow, in a frame where the flow fills the lanes of a line
+// before going to the next line: x is the lane, y the line. The lines before the front are
+// full, the searches start at the front
+class FlowGrid {
+
+public:
+    // With lines < 0, lines are added as needed
+    FlowGrid(int lanes, int lines)
+        : lanes(lanes), lines(lines), front(0), lineCount(0)
+    {
+    }
+
+    bool fits(const QRect &area) const {
+        if (area.left() < 0 || area.right() >= lanes || area.top() < 0 || (lines >= 0 && area.bottom() >= lines)) {
+            return false;
+        }
+        for (int line = area.top(); line <= qMin(area.bottom(), lineCount - 1); ++line) {
+            for (int lane = area.left(); lane <= area.right(); ++lane) {
+                if (taken.at(line * lanes + lane)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void take(const QRect &area) {
+        if (lineCount <= area.bottom()) {
+            lineCount = area.bottom() + 1;
+            taken.resize(lineCount * lanes);
+            while (freeCells.size() < lineCount) {
+                freeCells.append(lanes);
+            }
+        }
+        for (int line = area.top(); line <= area.bottom(); ++line) {
+            for (int lane = area.left(); lane <= area.right(); ++lane) {
+                if (!taken.at(line * lanes + lane)) {
+                    taken[line * lanes + lane] = true;
+                    --freeCells[line];
+                }
+            }
+        }
+        while (front < lineCount && freeCells.at(front) == 0) {
+            ++front;
+        }
+    }
+
+    // Returns the first position (line * lanes + lane) from the given one where an area of the
+    // size fits, -1 if there is none
+    int find(const QSize &size, int position) const {
+        for (position = qMax(position, front * lanes); lines < 0 || position < lines * lanes; ++position) {
+            if (fits(QRect(QPoint(position % lanes, position / lanes), size))) {
+                return position;
+            }
+        }
+        return -1;
+    }
+
+private:
+    int lanes;
+    int lines;
+    int front;                  // the first line with a free cell
+    int lineCount;              // lines with a taken cell or before one
+    QVector<bool> taken;        // line by line
+    QVector<int> freeCells;     // free cells of each line
+};
+
+const char *const LayoutFormat = "qtilelayout";
+const int LayoutVersion = 1;
+
+// Reads a text string, which may come in several chunks
+bool readCborText(QCborStreamReader &reader, QString &text) {
+    if (!reader.isString()) {
+        return false;
+    }
+
+    text.clear();
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        text += chunk.data;
+        chunk = reader.readString();
+    }
+    return chunk.status == QCborStreamReader::EndOfString;
+}
+
+bool readCborInteger(QCborStreamReader &reader, qint64 &value) {
+    if (!reader.isInteger()) {
+        return false;
+    }
+
+    value = reader.toInteger();
+    return reader.next();
+}
+
+}
 
 QTileLayout::QTileLayout(int rowNumber, int columnNumber, int verticalSpan, int horizontalSpan,
                          int verticalSpacing, int horizontalSpacing, QWidget *parent)
-    : QGridLayout(parent), rowNumber(rowNumber), columnNumber(columnNumber),
+    : QLayout(parent), rowNumber(rowNumber), columnNumber(columnNumber),
     verticalSpan(verticalSpan), horizontalSpan(horizontalSpan),
     minVerticalSpan(verticalSpan), minHorizontalSpan(horizontalSpan),
-    dragAndDrop(true), resizable(true), focus(false), widgetToDrop(nullptr)
+    verticalGap(verticalSpacing), horizontalGap(horizontalSpacing),
+    dragAndDrop(true), resizable(true), focus(false), pushing(false), maxPushChain(8),
+    replaying(false), takingTile(false), holdOverlay(false), changeDepth(0), publishedSnapshot(nullptr), snapshotReaders(0),
+    prefetchMargin(200), lazyPolicy(KeepLazyWidgets), releaseMargin(2000), lazyUpdateScheduled(false), flowMode(RowFlow),
+    flowDirty(0, 0), flowReserved(-1, -1),
+    currentBreakpoint(-1),
+    resizeMargin(5), dragInProcess(false), currentTileNumber(0), freezeUpdates(false)
 {
-    // Set spacing
-    QGridLayout::setVerticalSpacing(verticalSpacing);
-    QGridLayout::setHorizontalSpacing(horizontalSpacing);
-
-    // Logic parameters
-    dragAndDrop = true;
-    resizable = true;
-    focus = false;
-    widgetToDrop = nullptr;
-
-    tileMap = {};
-    widgetTileCouple = {
-        { "widget", QList<QWidget *>() },
-        { "tile"  , QList<QWidget *>() }
-    };
+    qRegisterMetaType<QVector<PlacementChange>>("QVector<PlacementChange>");
 
     id = QUuid::createUuid();
     // id = QUuid::createUuid().toString();
@@ -34,19 +242,49 @@ QTileLayout::QTileLayout(int rowNumber, int columnNumber, int verticalSpan, int
     cursorGrab = Qt::OpenHandCursor;
     cursorResizeHorizontal = Qt::SizeHorCursor;
     cursorResizeVertical = Qt::SizeVerCursor;
+    containerCursor = Qt::ArrowCursor;
 
     colorMap = {
         {"drag_and_drop",   QColor(255, 211, 211)},
         {"idle",            QColor(240, 240, 240)},
         {"resize",          QColor(211, 255, 211)},
-        {"empty_check",     QColor(150, 150, 150)}
+        {"empty_check",     QColor(150, 150, 150)},
+        {"selection",       QColor(90, 140, 230)}
     };
 
-    setRowStretch(rowNumber, 1);
-    setColumnStretch(columnNumber, 1);
-
     createTileMap();
+    publishSnapshot();
+    attachParentWidget();
+}
+
+QTileLayout::~QTileLayout() {
+    // The linked layouts forget this one, and the steps they shared with it. The commands they
+    // pushed no longer match their history
+    QSet<quint64> links = journal.links();
+    for (QTileLayout *layout : qAsConst(linkedLayout)) {
+        if (layout != this) {
+            layout->linkedLayout.remove(id);
+            if (layout->journal.forgetLinks(links)) {
+                delete layout->history;
+            }
+        }
+    }
+
+    takingTile = true;
+    QLayoutItem *item;
+    while ((item = takeAt(0))) {
+        delete item;
+    }
+
+    if (container) {
+        container->removeEventFilter(this);
+    }
+    delete overlay;
 
+    for (const std::shared_ptr<const TileSnapshot> *retired : qAsConst(retiredSnapshots)) {
+        delete retired;
+    }
+    delete publishedSnapshot.load();
 }
 
 //adds a widget in the layout: works like the addWidget method in a gridLayout
@@ -54,28 +292,12 @@ void QTileLayout::addWidget(QWidget *widget, int fromRow, int fromColumn, int ro
 {
     // Q_ASSERT(!widgetList().contains(widget));
     // Q_ASSERT(isAreaEmpty(fromRow, fromColumn, rowSpan, columnSpan));
-    if( !widgetTileCouple["widget"].contains(widget)
+    if( !placementIndex.contains(widget)
         && isAreaEmpty(fromRow, fromColumn, rowSpan, columnSpan))
     {
-        // Gets the tile at the specified position
-        Tile* tile = tileMap[fromRow][fromColumn];
-        // Adds the widget and tile to the widgetTileCouple
-        widgetTileCouple["widget"].append(widget);
-        widgetTileCouple["tile"].append(tile);
-
-        widgetToDrop = widget;
-        widget->setMouseTracking(true);
-        tile->addWidget(widget);
-
-        // If the widget is on more than 1 tile, the tiles must be merged
-        if (rowSpan > 1 || columnSpan > 1) {
-            QList<QPoint> tilesToMerge;
-            for (int row = 0; row < rowSpan; ++row)
-                for (int column = 0; column < columnSpan; ++column)
-                    tilesToMerge.append(QPoint(fromRow + row, fromColumn + column));
-
-            mergeTiles(tile, fromRow, fromColumn, rowSpan, columnSpan, tilesToMerge.mid(1));
-        }
+        QRect area(fromColumn, fromRow, columnSpan, rowSpan);
+        insertTile(widget, area);
+        recordChange(widget, QRect(), area);
         // qDebug() << "Widget created: " << widget->objectName() << "row: "<< fromRow << "col: " <<fromColumn;
     }
 
@@ -87,51 +309,294 @@ void QTileLayout::removeWidget(QWidget *widget) {
     // Q_ASSERT(widgetList().contains(widget));
     if (widgetList().contains(widget))
     {
-        int index = widgetTileCouple["widget"].indexOf(widget);
-        if (index < 0 || index >= widgetTileCouple["tile"].size()) {
-            qWarning() << "QTileLayout::removeWidget: widgetTileCouple desync or index out of bounds. Index:" << index << "Tile list size:" << widgetTileCouple["tile"].size();
-            return;
+        QRect area = takeTile(widget);
+        if (area.isValid()) {
+            changeTilesColor("idle");
+            recordChange(widget, area, QRect());
         }
-        Tile *tile = dynamic_cast<Tile*>(widgetTileCouple["tile"].at(index));
 
-        int fromRow = tile->getFromRow();
-        int fromColumn = tile->getFromColumn();
-        int rowSpan = tile->getRowSpan();
-        int columnSpan = tile->getColumnSpan();
+        // qDebug() << "Widget removed: " << widget->objectName() << "row: "<< area.y() << "col: " << area.x();
+    }
 
-        QList<QPoint> tilesToSplit;
-        for (int row = 0; row < rowSpan; row++)
-            for (int column = 0; column < columnSpan; column++)
-                tilesToSplit.append(QPoint(fromRow + row, fromColumn + column));
+}
 
-        widget->setMouseTracking(false);
-        splitTiles(tile, fromRow, fromColumn, rowSpan, columnSpan, tilesToSplit);
-        hardSplitTiles(fromRow, fromColumn, tilesToSplit);
-        widgetTileCouple["widget"].removeAt(index);
-        widgetTileCouple["tile"].removeAt(index);
-        changeTilesColor("idle");
+// Removes the given widgets in a single operation. The widgets are returned hidden, still
+// children of the parent widget, to be reused; or deleted if deleteWidgets is true
+QList<QWidget*> QTileLayout::removeWidgets(const QList<QWidget*> &widgets, bool deleteWidgets) {
+    QSet<QWidget*> toRemove;
+    for (QWidget *widget : widgets) {
+        toRemove.insert(widget);
+    }
 
-        // qDebug() << "Widget removed: " << widget->objectName() << "row: "<< fromRow << "col: " <<fromColumn;
+    QVector<bool> removed(placedWidgets.size());
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        removed[index] = toRemove.contains(placedWidgets.at(index));
     }
+    return takeTiles(removed, deleteWidgets);
+}
 
+// Removes the widgets covering at least one cell of the area, see removeWidgets()
+QList<QWidget*> QTileLayout::removeWidgetsInRect(const QRect &area, bool deleteWidgets) {
+    QVector<bool> removed(placedWidgets.size());
+    for (int index = 0; index < placedAreas.size(); ++index) {
+        removed[index] = placedAreas.at(index).intersects(area);
+    }
+    return takeTiles(removed, deleteWidgets);
 }
 
-void QTileLayout::addRows(int rowNumber) {
-    // Q_ASSERT(rowNumber > 0);
-    if(rowNumber > 0)
-    {
-        setRowStretch(this->rowNumber, 0);
+// Removes all the widgets, see removeWidgets()
+QList<QWidget*> QTileLayout::clear(bool deleteWidgets) {
+    return takeTiles(QVector<bool>(placedWidgets.size(), true), deleteWidgets);
+}
+
+// Gives the layout a whole arrangement: each widget of the map gets its area, the widgets
+// missing from the map are removed (hidden, see removeWidgets()). Only the widgets whose area
+// changes are touched, in a single operation: the areas left are all freed before the new ones
+// are filled, so the order of the moves does not matter. Returns false, leaving the layout
+// untouched, if an area is out of the grid or overlaps another one
+bool QTileLayout::applyArrangement(const QMap<QWidget*, QRect> &arrangement) {
+    TileIndex target;
+    target.reset(rowNumber, columnNumber, tileMap.isSparse());
+    QRect grid(0, 0, columnNumber, rowNumber);
+    for (auto placement = arrangement.constBegin(); placement != arrangement.constEnd(); ++placement) {
+        if (!placement.key() || !grid.contains(placement.value()) || !target.isFree(placement.value())) {
+            return false;
+        }
+        target.insert(placement.key(), placement.value());
+    }
+
+    QVector<PlacementChange> changes;
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        QRect area = arrangement.value(placedWidgets.at(index));
+        if (area != placedAreas.at(index)) {
+            changes.append({placedWidgets.at(index), placedAreas.at(index), area});
+        }
+    }
+    for (auto placement = arrangement.constBegin(); placement != arrangement.constEnd(); ++placement) {
+        if (!placementIndex.contains(placement.key())) {
+            changes.append({placement.key(), QRect(), placement.value()});
+        }
+    }
 
-        for (int row = this->rowNumber; row < this->rowNumber + rowNumber; ++row) {
-            tileMap.append(QList<Tile*>());
-            for (int column = 0; column < columnNumber; ++column) {
-                Tile *tile = createTile(row, column);
-                tileMap.last().append(tile);
+    // The whole arrangement is notified once, by layoutChanged
+    if (!changes.isEmpty()) {
+        commitChanges(changes, false);
+    }
+    return true;
+}
+
+// Same as above, the widgets being given by their object name: a widget of the layout, or a
+// child of the parent widget taken out of the layout before. Returns false if a name is unknown
+bool QTileLayout::applyArrangement(const QMap<QString, QRect> &arrangement) {
+    QMap<QString, QWidget*> named;
+    for (QWidget *widget : qAsConst(placedWidgets)) {
+        named.insert(widget->objectName(), widget);
+    }
+
+    QMap<QWidget*, QRect> widgets;
+    for (auto placement = arrangement.constBegin(); placement != arrangement.constEnd(); ++placement) {
+        QWidget *widget = named.value(placement.key());
+        if (!widget && container) {
+            widget = container->findChild<QWidget*>(placement.key(), Qt::FindDirectChildrenOnly);
+        }
+        if (!widget) {
+            return false;
+        }
+        widgets.insert(widget, placement.value());
+    }
+    return applyArrangement(widgets);
+}
+
+// Writes the whole layout in CBOR: a map of the grid values (see LayoutValueKeys) and of the
+// placements, an array of [name, row, column, row span, column span] arrays. The widgets are
+// named by their object name
+bool QTileLayout::exportLayout(QIODevice *device) const {
+    if (!device || !device->isWritable()) {
+        return false;
+    }
+
+    QCborStreamWriter writer(device);
+    writer.startMap();
+    writer.append(QLatin1String("format"));
+    writer.append(QLatin1String(LayoutFormat));
+    writer.append(QLatin1String("version"));
+    writer.append(LayoutVersion);
+    for (const char *key : LayoutValueKeys) {
+        writer.append(QLatin1String(key));
+        writer.append(layoutValue(QLatin1String(key)));
+    }
+
+    writer.append(QLatin1String("placements"));
+    writer.startArray(placedWidgets.size());
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        const QRect &area = placedAreas.at(index);
+        writer.startArray(5);
+        writer.append(placedWidgets.at(index)->objectName());
+        writer.append(area.top());
+        writer.append(area.left());
+        writer.append(area.height());
+        writer.append(area.width());
+        writer.endArray();
+    }
+    writer.endArray();
+    writer.endMap();
+    return true;
+}
+
+// Replaces the layout with the one written by exportLayout(). The placements are read one at a
+// time and placed as they come, in a single operation, without loading the whole document.
+// A placement is skipped if no widget of the layout has its name, or if its area is taken.
+// The format and version must come first, nothing is applied before they are read, and the
+// grid size must come before the placements. Returns false, with the layout put back as it
+// was, if the data is not a layout of this version or is cut short
+bool QTileLayout::importLayout(QIODevice *device) {
+    QCborStreamReader reader(device);
+    if (!reader.isMap() || !reader.enterContainer()) {
+        return false;
+    }
+
+    LayoutBuild build;
+    saveLayoutState(build);
+
+    QSize grid(-1, -1);
+    QString format;
+    qint64 version = 0;
+    QString key;
+    bool valid = true;
+    while (valid && reader.hasNext()) {
+        if (!readCborText(reader, key)) {
+            valid = false;
+        } else if (key == QLatin1String("format")) {
+            valid = readCborText(reader, format) && format == QLatin1String(LayoutFormat);
+        } else if (key == QLatin1String("version")) {
+            valid = readCborInteger(reader, version) && version == LayoutVersion;
+        } else if (format.isEmpty() || version != LayoutVersion) {
+            valid = false;
+        } else if (build.started && (key == QLatin1String("rows") || key == QLatin1String("columns"))) {
+            // The placements have been checked against the grid read before them
+            valid = false;
+        } else if (key == QLatin1String("placements")) {
+            valid = reader.isArray() && !build.started && beginLayoutBuild(build, grid) && reader.enterContainer();
+            while (valid && reader.hasNext()) {
+                QString name;
+                qint64 values[4];
+                valid = reader.isArray() && reader.enterContainer() && readCborText(reader, name);
+                for (qint64 &value : values) {
+                    valid = valid && readCborInteger(reader, value);
+                }
+                valid = valid && reader.leaveContainer();
+
+                if (valid) {
+                    buildPlacement(build, name, QRect(values[1], values[0], values[3], values[2]));
+                }
             }
+            valid = valid && reader.leaveContainer();
+        } else if (reader.isInteger()) {
+            qint64 value = 0;
+            valid = readCborInteger(reader, value);
+            applyLayoutValue(key, value, grid);
+        } else {
+            valid = reader.next();
+        }
+    }
+
+    if (valid && build.started && reader.leaveContainer() && reader.lastError() == QCborError::NoError) {
+        endLayoutBuild();
+        return true;
+    }
+    restoreLayoutState(build);
+    return false;
+}
+
+// Writes the layout in JSON, with the structure of exportLayout()
+QByteArray QTileLayout::exportLayoutJson() const {
+    QJsonObject data;
+    data["format"] = QLatin1String(LayoutFormat);
+    data["version"] = LayoutVersion;
+    for (const char *key : LayoutValueKeys) {
+        data[QLatin1String(key)] = layoutValue(QLatin1String(key));
+    }
+
+    QJsonArray placements;
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        const QRect &area = placedAreas.at(index);
+        placements.append(QJsonArray({placedWidgets.at(index)->objectName(), area.top(), area.left(), area.height(), area.width()}));
+    }
+    data["placements"] = placements;
+
+    return QJsonDocument(data).toJson(QJsonDocument::Compact);
+}
+
+// Replaces the layout with the one written by exportLayoutJson(), see importLayout()
+bool QTileLayout::importLayoutJson(const QByteArray &json) {
+    QJsonObject data = QJsonDocument::fromJson(json).object();
+    if (data["format"].toString() != QLatin1String(LayoutFormat) || data["version"].toInt() != LayoutVersion
+        || !data["placements"].isArray() || data["rows"].toInt() <= 0 || data["columns"].toInt() <= 0) {
+        return false;
+    }
+
+    QSize grid(-1, -1);
+    for (const char *key : LayoutValueKeys) {
+        if (data.contains(QLatin1String(key))) {
+            applyLayoutValue(QLatin1String(key), data[QLatin1String(key)].toInt(), grid);
         }
+    }
+
+    LayoutBuild build;
+    if (!beginLayoutBuild(build, grid)) {
+        return false;
+    }
+    const QJsonArray placements = data["placements"].toArray();
+    for (const QJsonValue &value : placements) {
+        QJsonArray placement = value.toArray();
+        buildPlacement(build, placement.at(0).toString(), QRect(
+            placement.at(2).toInt(), placement.at(1).toInt(), placement.at(4).toInt(), placement.at(3).toInt()
+            ));
+    }
+    endLayoutBuild();
+    return true;
+}
+
+// Reserves the area for a widget created by the factory only when the area comes within the
+// prefetch margin of the visible part of the parent widget. The area is held by the returned
+// LazyTile, the created widget fills it
+LazyTile *QTileLayout::addLazyWidget(LazyTile::Factory factory, int fromRow, int fromColumn, int rowSpan, int columnSpan) {
+    if (!isAreaEmpty(fromRow, fromColumn, rowSpan, columnSpan)) {
+        return nullptr;
+    }
+
+    LazyTile *tile = new LazyTile(std::move(factory), parentWidget());
+    addWidget(tile, fromRow, fromColumn, rowSpan, columnSpan);
+    lazyTiles.append(tile);
+    scheduleLazyUpdate();
+    return tile;
+}
+
+// Sets how far out of the visible part of the parent widget the lazy widgets are created
+void QTileLayout::setPrefetchMargin(int pixels) {
+    prefetchMargin = qMax(0, pixels);
+    updateLazyWidgets();
+}
+
+// Sets what happens to the lazy widgets further than releaseMargin pixels out of the visible
+// part of the parent widget. The margin is kept larger than the prefetch one
+void QTileLayout::setLazyPolicy(LazyPolicy policy, int releaseMargin) {
+    lazyPolicy = policy;
+    this->releaseMargin = releaseMargin;
+    updateLazyWidgets();
+}
 
+void QTileLayout::addRows(int rowNumber) {
+    // Q_ASSERT(rowNumber > 0);
+    if(rowNumber > 0)
+    {
         this->rowNumber += rowNumber;
-        setRowStretch(this->rowNumber, 1);
+        createTileMap();
+        publishSnapshot();
+        invalidate();
+        if (overlay) {
+            overlay->updateCells();
+        }
     }
 }
 
@@ -140,18 +605,13 @@ void QTileLayout::addColumns(int columnNumber) {
     // Q_ASSERT(columnNumber > 0);
     if(columnNumber > 0)
     {
-        setColumnStretch(this->columnNumber, 0);
-
-        for (int row = 0; row < rowNumber; ++row) {
-            for (int column = this->columnNumber; column < this->columnNumber + columnNumber; ++column) {
-                Tile *tile = createTile(row, column);
-                tileMap[row].append(tile);
-            }
-        }
-
         this->columnNumber += columnNumber;
-        setColumnStretch(this->columnNumber, 1);
-        QGridLayout::update();
+        createTileMap();
+        publishSnapshot();
+        invalidate();
+        if (overlay) {
+            overlay->updateCells();
+        }
         qDebug() << "Added column";
     }
 }
@@ -160,18 +620,13 @@ void QTileLayout::removeRows(int rowNumber) {
     // Q_ASSERT(isAreaEmpty(this->rowNumber - rowNumber, 0, rowNumber, columnNumber));
     if (isAreaEmpty(this->rowNumber - rowNumber, 0, rowNumber, this->columnNumber))
     {
-        for (int row = this->rowNumber - rowNumber; row < this->rowNumber; ++row)
-        {
-            for (int column = 0; column < columnNumber; ++column) {
-                QGridLayout::removeWidget(tileMap[row][column]);
-                tileMap[row][column]->deleteLater();
-            }
-            setRowMinimumHeight(row, 0);
-            setRowStretch(row, 0);
-        }
-
         this->rowNumber -= rowNumber;
-        tileMap.erase(tileMap.begin() + this->rowNumber, tileMap.end());
+        createTileMap();
+        publishSnapshot();
+        invalidate();
+        if (overlay) {
+            overlay->updateCells();
+        }
     }
 
 }
@@ -180,19 +635,12 @@ void QTileLayout::removeColumns(int columnNumber) {
     // Q_ASSERT(isAreaEmpty(0, this->columnNumber - columnNumber, rowNumber, columnNumber));
     if (isAreaEmpty(0, this->columnNumber - columnNumber, this->rowNumber, columnNumber))
     {
-        for (int column = this->columnNumber - columnNumber; column < this->columnNumber; ++column) {
-            for (int row = 0; row < rowNumber; ++row) {
-                QGridLayout::removeWidget(tileMap[row][column]);
-                tileMap[row][column]->deleteLater();
-            }
-
-            setColumnMinimumWidth(column, 0);
-            setColumnStretch(column, 0);
-        }
-
         this->columnNumber -= columnNumber;
-        for (int row = 0; row < rowNumber; ++row) {
-            tileMap[row].erase(tileMap[row].begin() + this->columnNumber, tileMap[row].end());
+        createTileMap();
+        publishSnapshot();
+        invalidate();
+        if (overlay) {
+            overlay->updateCells();
         }
     }
 
@@ -224,6 +672,9 @@ void QTileLayout::setCursorResizeVertical(Qt::CursorShape value) {
 
 void QTileLayout::setColorIdle(QColor color) {
     colorMap["idle"] = color;
+    if (overlay) {
+        overlay->setIdleColor(color);
+    }
     changeTilesColor("idle");
 }
 
@@ -239,6 +690,13 @@ void QTileLayout::setColorEmptyCheck(QColor color) {
     colorMap["empty_check"] = color;
 }
 
+void QTileLayout::setColorSelection(QColor color) {
+    colorMap["selection"] = color;
+    if (overlay) {
+        overlay->setSelectionColor(color);
+    }
+}
+
 int QTileLayout::rowCount() const {
     return rowNumber;
 }
@@ -247,8 +705,55 @@ int QTileLayout::columnCount() const {
     return columnNumber;
 }
 
+// Returns the geometry of the cell in the parent widget
 QRect QTileLayout::tileRect(int row, int column) const {
-    return tileMap[row][column]->rect();
+    return areaRect(QRect(column, row, 1, 1));
+}
+
+// Returns the geometry of an area of cells in the parent widget: the cells are laid out
+// from the top left corner of the layout, the spacings are included between them
+QRect QTileLayout::areaRect(const QRect &area) const {
+    QPoint origin = contentsRect().topLeft();
+    return QRect(
+        origin.x() + area.left() * (horizontalSpan + horizontalGap),
+        origin.y() + area.top() * (verticalSpan + verticalGap),
+        area.width() * horizontalSpan + (area.width() - 1) * horizontalGap,
+        area.height() * verticalSpan + (area.height() - 1) * verticalGap
+        );
+}
+
+// Returns the cell at the position of the parent widget: x is the column, y the row.
+// Returns (-1, -1) if the position is out of the grid or between two cells
+QPoint QTileLayout::cellAt(const QPoint &position) const {
+    QPoint local = position - contentsRect().topLeft();
+    if (local.x() < 0 || local.y() < 0) {
+        return QPoint(-1, -1);
+    }
+
+    int column = local.x() / (horizontalSpan + horizontalGap);
+    int row = local.y() / (verticalSpan + verticalGap);
+    if (column >= columnNumber || row >= rowNumber
+        || local.x() % (horizontalSpan + horizontalGap) >= horizontalSpan
+        || local.y() % (verticalSpan + verticalGap) >= verticalSpan) {
+        return QPoint(-1, -1);
+    }
+
+    return QPoint(column, row);
+}
+
+// Returns the cells a rectangle of the parent widget lies on, the spacing after a cell
+// counting as part of it. The result is empty if the rectangle is out of the grid
+QRect QTileLayout::areaAt(const QRect &rect) const {
+    QRect local = rect.translated(-contentsRect().topLeft());
+    if (local.right() < 0 || local.bottom() < 0) {
+        return QRect();
+    }
+
+    QRect cells(
+        QPoint(qMax(0, local.left()) / (horizontalSpan + horizontalGap), qMax(0, local.top()) / (verticalSpan + verticalGap)),
+        QPoint(local.right() / (horizontalSpan + horizontalGap), local.bottom() / (verticalSpan + verticalGap))
+        );
+    return cells & QRect(0, 0, columnNumber, rowNumber);
 }
 
 int QTileLayout::rowsMinimumHeight() const {
@@ -263,7 +768,7 @@ void QTileLayout::setRowsMinimumHeight(int height) {
     minVerticalSpan = height;
     if (minVerticalSpan > verticalSpan) {
         verticalSpan = minVerticalSpan;
-        updateAllTiles();
+        invalidate();
     }
 }
 
@@ -272,8 +777,38 @@ void QTileLayout::setColumnsMinimumWidth(int width)
     minHorizontalSpan = width;
     if (minHorizontalSpan > horizontalSpan) {
         horizontalSpan = minHorizontalSpan;
-        updateAllTiles();
+        invalidate();
+    }
+}
+
+// Limits the spans the widget can be resized to, in cells (width in columns, height in rows),
+// and keeps its columns over rows close to the aspect ratio if it is not null. The limits also
+// apply when the widgets are reflowed. A placed widget out of the limits is resized at once
+// if the cells it needs are free
+void QTileLayout::setSpanConstraints(QWidget *widget, const QSize &minimumSpan, const QSize &maximumSpan, qreal aspectRatio) {
+    if (!widget) {
+        return;
+    }
+
+    if (!spanConstraints.contains(widget)) {
+        connect(widget, &QObject::destroyed, this, [this, widget]() {
+            spanConstraints.remove(widget);
+        });
     }
+    spanConstraints.insert(widget, {minimumSpan, maximumSpan, aspectRatio});
+
+    QRect area = placementOf(widget);
+    if (area.isValid() && !fitsConstraints(widget, area.size())) {
+        QRect constrained(area.topLeft(), constrainedSpan(widget, area.size(), true));
+        if (relocateTile(widget, constrained)) {
+            recordChange(widget, area, constrained);
+            emit tileResized(widget, constrained.top(), constrained.left(), constrained.height(), constrained.width());
+        }
+    }
+}
+
+void QTileLayout::clearSpanConstraints(QWidget *widget) {
+    spanConstraints.remove(widget);
 }
 
 void QTileLayout::setRowsHeight(int height)
@@ -282,7 +817,7 @@ void QTileLayout::setRowsHeight(int height)
     if (minVerticalSpan <= height)
     {
         verticalSpan = height;
-        updateAllTiles();
+        invalidate();
     }
 }
 
@@ -292,20 +827,44 @@ void QTileLayout::setColumnsWidth(int width)
     if (minHorizontalSpan <= width)
     {
         horizontalSpan = width;
-        updateAllTiles();
+        invalidate();
     }
 }
 
+int QTileLayout::verticalSpacing() const
+{
+    return verticalGap;
+}
+
+int QTileLayout::horizontalSpacing() const
+{
+    return horizontalGap;
+}
+
 void QTileLayout::setVerticalSpacing(int spacing)
 {
-    QGridLayout::setVerticalSpacing(spacing);
-    updateAllTiles();
+    verticalGap = spacing;
+    invalidate();
 }
 
 void QTileLayout::setHorizontalSpacing(int spacing)
 {
-    QGridLayout::setHorizontalSpacing(spacing);
-    updateAllTiles();
+    horizontalGap = spacing;
+    invalidate();
+}
+
+// Switches between a dense map of the cells and a sparse index of the placed areas. The sparse
+// grid suits huge layouts with few widgets: memory and occupancy queries scale with the number
+// of widgets instead of the number of cells
+void QTileLayout::setSparseGrid(bool sparse) {
+    if (sparse != tileMap.isSparse()) {
+        tileMap.reset(rowNumber, columnNumber, sparse);
+        createTileMap();
+    }
+}
+
+bool QTileLayout::isSparseGrid() const {
+    return tileMap.isSparse();
 }
 
 QString QTileLayout::getId() const
@@ -318,9 +877,87 @@ void QTileLayout::activateFocus(bool focus)
     this->focus = focus;
 }
 
-QList<QWidget*> QTileLayout::widgetList() const
+// Turns the updates of the placed widgets off while a widget is dragged or resized, so that
+// expensive widgets do not slow the interaction down. They are painted again once at its end
+void QTileLayout::freezeUpdatesDuringInteraction(bool value)
+{
+    freezeUpdates = value;
+}
+
+const QList<QWidget*> &QTileLayout::widgetList() const
+{
+    return placedWidgets;
+}
+
+// Returns the placements as of the end of the last operation. Unlike the rest of the class,
+// this can be called from any thread, without a lock: the reader announces itself while it
+// copies the published pointer, which is not deleted until no reader is announced
+std::shared_ptr<const TileSnapshot> QTileLayout::snapshot() const
 {
-    return widgetTileCouple["widget"];
+    snapshotReaders.fetch_add(1);
+    const std::shared_ptr<const TileSnapshot> *published = publishedSnapshot.load();
+    std::shared_ptr<const TileSnapshot> current = published ? *published : nullptr;
+    snapshotReaders.fetch_sub(1);
+    return current;
+}
+
+// Returns the widget covering the cell, nullptr if the cell is empty or out of the grid
+QWidget* QTileLayout::widgetAt(int row, int column) const {
+    return tileMap.widgetAt(row, column);
+}
+
+// Returns the cells covered by the widget, a null rect if it is not in the layout
+QRect QTileLayout::placementOf(QWidget *widget) const {
+    int index = placementIndex.value(widget, -1);
+    return index < 0 ? QRect() : placedAreas.at(index);
+}
+
+// Returns the widgets covering at least one cell of the area. Prefer forEachWidgetInRect()
+// in code called often, it does not build a list
+QList<QWidget*> QTileLayout::widgetsInRect(const QRect &area) const {
+    QList<QWidget*> widgets;
+    forEachWidgetInRect(area, [&widgets](QWidget *widget, const QRect &) {
+        widgets.append(widget);
+    });
+    return widgets;
+}
+
+// Returns the selected widgets that are in the layout
+QList<QWidget*> QTileLayout::selection() const {
+    QList<QWidget*> widgets;
+    for (const QPointer<QWidget> &widget : selectedWidgets) {
+        if (widget && placementIndex.contains(widget)) {
+            widgets.append(widget);
+        }
+    }
+    return widgets;
+}
+
+// Selects the given widgets of the layout: they are dragged together
+void QTileLayout::setSelection(const QList<QWidget*> &widgets) {
+    QList<QWidget*> previous = selection();
+    selectedWidgets.clear();
+    for (QWidget *widget : widgets) {
+        if (placementIndex.contains(widget) && !selectedWidgets.contains(widget)) {
+            selectedWidgets.append(widget);
+        }
+    }
+
+    if (overlay) {
+        for (QWidget *widget : qAsConst(previous)) {
+            overlay->updateCells(placementOf(widget));
+        }
+        for (const QPointer<QWidget> &widget : qAsConst(selectedWidgets)) {
+            overlay->updateCells(placementOf(widget));
+        }
+    }
+    emit selectionChanged();
+}
+
+void QTileLayout::clearSelection() {
+    if (!selectedWidgets.isEmpty()) {
+        setSelection({});
+    }
 }
 
 // Links this layout with another one to allow drag and drop between them
@@ -346,96 +983,422 @@ void QTileLayout::unLinkLayout(QTileLayout *layout) {
     }
 }
 
-// Highlights tiles that will be merged during resizing
+// Highlights the area the widget at (fromRow, fromColumn) will cover once resized
 void QTileLayout::highlightTiles(QPoint direction, int fromRow, int fromColumn, int tileNumber) {
-    Tile *tile = tileMap[fromRow][fromColumn];
-    QList<QPoint> tilesToMerge;
-    bool increase;
-    int rowSpan, columnSpan;
-    std::tie(tilesToMerge, increase, fromRow, fromColumn, rowSpan, columnSpan) = getTilesToBeResized(
-        tile, direction, fromRow, fromColumn, tileNumber
-        );
+    QWidget *widget = widgetAt(fromRow, fromColumn);
+    if (!widget) {
+        return;
+    }
+    tileNumber = clampedTileNumber(widget, direction, tileNumber);
 
-    if (!tilesToMerge.isEmpty()) {
-        changeTilesColor("empty_check", QPoint(fromRow, fromColumn), QPoint(rowSpan, columnSpan));
+    // In push mode, the whole requested area is highlighted if the neighbours can make room
+    if (pushing && tileNumber * (direction.x() + direction.y()) > 0) {
+        QRect area = grownArea(placementOf(widget), direction, tileNumber);
+        if (fitsConstraints(widget, area.size()) && !planPush(widget, area, direction).isEmpty()) {
+            changeTilesColor("empty_check", QPoint(area.top(), area.left()), QPoint(area.height(), area.width()));
+            return;
+        }
+    }
+
+    QRect area = resizedArea(widget, direction, tileNumber);
+    if (area != placementOf(widget)) {
+        changeTilesColor("empty_check", QPoint(area.top(), area.left()), QPoint(area.height(), area.width()));
     }
 }
 
 void QTileLayout::resizeTile(QPoint direction, int fromRow, int fromColumn, int tileNumber) {
-    Tile *tile = tileMap[fromRow][fromColumn];
-    QList<QPoint> tilesToMerge;
-    bool increase;
-    int rowSpan, columnSpan;
-    std::tie(tilesToMerge, increase, fromRow, fromColumn, rowSpan, columnSpan) = getTilesToBeResized(
-        tile, direction, fromRow, fromColumn, tileNumber
-        );
-
-    if (!tilesToMerge.isEmpty()) {
-        if (increase) {
-            mergeTiles(tile, fromRow, fromColumn, rowSpan, columnSpan, tilesToMerge);
-        } else {
-            splitTiles(tile, fromRow, fromColumn, rowSpan, columnSpan, tilesToMerge);
+    QWidget *widget = widgetAt(fromRow, fromColumn);
+    if (!widget) {
+        return;
+    }
+    QRect previousArea = placementOf(widget);
+    tileNumber = clampedTileNumber(widget, direction, tileNumber);
+
+    // In push mode, the neighbours in the way are displaced instead of stopping the resize
+    if (pushing && tileNumber * (direction.x() + direction.y()) > 0) {
+        QRect area = grownArea(previousArea, direction, tileNumber);
+        QVector<PlacementChange> changes;
+        if (fitsConstraints(widget, area.size())) {
+            changes = planPush(widget, area, direction);
+        }
+        if (!changes.isEmpty()) {
+            commitChanges(changes);
+            return;
         }
-        int index = widgetTileCouple["tile"].indexOf(tile);
-        QWidget *widget = widgetTileCouple["widget"].at(index);
-        emit tileResized(widget, fromRow, fromColumn, rowSpan, columnSpan);
+    }
+
+    QRect area = resizedArea(widget, direction, tileNumber);
+    if (area != previousArea && relocateTile(widget, area)) {
+        recordChange(widget, previousArea, area);
+        emit tileResized(widget, area.top(), area.left(), area.height(), area.width());
     }
 }
 
-// Splits the tiles and return the new one at (fromRow, fromColumn)
-Tile* QTileLayout::hardSplitTiles(int fromRow, int fromColumn, QList<QPoint> tilesToSplit) {
-    Q_ASSERT(tilesToSplit.contains(QPoint(fromRow, fromColumn)));
-    // if (tilesToSplit.contains(QPoint(fromRow, fromColumn)))
-    {
-        QSet<Tile*> tilesToRecycle = {};
+// Moves the widget at (fromRow, fromColumn) by one cell in the given direction
+void QTileLayout::moveTile(QPoint direction, int fromRow, int fromColumn) {
+    QWidget *widget = widgetAt(fromRow, fromColumn);
+    if (!widget) {
+        return;
+    }
 
-        for (const QPoint &point : qAsConst(tilesToSplit)) {
-            tilesToRecycle.insert(tileMap[point.x()][point.y()]);
-            qDebug() << __FUNCTION__ << point.x() << point.y();
-            createTile(point.x(), point.y(), 1, 1, true);
-        }
+    QRect previousArea = placementOf(widget);
+    QRect area = previousArea.translated(direction);
 
-        for (Tile *tile : qAsConst(tilesToRecycle)) {
-            QGridLayout::removeWidget(tile);
-            tile->deleteLater();
+    if (relocateTile(widget, area)) {
+        recordChange(widget, previousArea, area);
+        emit tileMoved(widget, getId(), getId(), previousArea.top(), previousArea.left(), area.top(), area.left());
+    } else if (pushing) {
+        QVector<PlacementChange> changes = planPush(widget, area, direction);
+        if (!changes.isEmpty()) {
+            commitChanges(changes);
         }
-
-        Tile *tile = tileMap[fromRow][fromColumn];
-        QGridLayout::addWidget(tile, fromRow, fromColumn);
-        return tile;
     }
 }
 
-// Checks if the given space is free from widgets
-bool QTileLayout::isAreaEmpty(int fromRow, int fromColumn, int rowSpan, int columnSpan, QString color) {
-    bool isEmpty = true;
-
-    if (!color.isEmpty() && colorMap.contains(color)) {
-        changeTilesColor(color);
+// Adds the widget in the given area, pushing the widgets in the way along the direction.
+// Returns false, leaving the layout untouched, if they cannot make room
+bool QTileLayout::pushWidget(QWidget *widget, int fromRow, int fromColumn, int rowSpan, int columnSpan, QPoint direction) {
+    if (placementIndex.contains(widget)) {
+        return false;
     }
 
-    if (tileMap.isEmpty() || fromRow + rowSpan > rowNumber || fromColumn + columnSpan > columnNumber || fromRow < 0 || fromColumn < 0) {
-        // If tileMap is empty (e.g. during initialization) or out of bounds, 
-        // we can't check for filled tiles. 
-        // If we are initializing, we assume it's empty/valid to proceed.
-        // If out of bounds, it's not empty (invalid).
-        if (tileMap.isEmpty()) return true; 
-        isEmpty = false;
+    QVector<PlacementChange> changes = planPush(widget, QRect(fromColumn, fromRow, columnSpan, rowSpan), direction);
+    if (changes.isEmpty()) {
+        return false;
     }
-    else
-    {
-        for (int row = 0; row < rowSpan; row++) {
-            for (int column = 0; column < columnSpan; column++) {
-                if (tileMap[fromRow + row][fromColumn + column]->isFilled()) {
-                    isEmpty = false;
-                    break;
-                }
+
+    commitChanges(changes);
+    return true;
+}
+
+// Moves the widget so that its top left cell is at (toRow, toColumn), keeping its spans.
+// Only the cells it leaves and covers are touched. Returns false if the area is not free
+bool QTileLayout::moveWidget(QWidget *widget, int toRow, int toColumn) {
+    QRect previousArea = placementOf(widget);
+    QRect area(QPoint(toColumn, toRow), previousArea.size());
+    if (!previousArea.isValid() || area == previousArea || !relocateTile(widget, area)) {
+        return false;
+    }
+
+    recordChange(widget, previousArea, area);
+    emit tileMoved(widget, getId(), getId(), previousArea.top(), previousArea.left(), area.top(), area.left());
+    return true;
+}
+
+// Gives the widget new spans, keeping its top left cell. Returns false if the cells are not
+// free or the spans break the constraints of the widget
+bool QTileLayout::resizeWidget(QWidget *widget, int rowSpan, int columnSpan) {
+    QRect previousArea = placementOf(widget);
+    QRect area(previousArea.topLeft(), QSize(columnSpan, rowSpan));
+    if (!previousArea.isValid() || area == previousArea || !area.isValid()
+        || !fitsConstraints(widget, area.size()) || !relocateTile(widget, area)) {
+        return false;
+    }
+
+    recordChange(widget, previousArea, area);
+    emit tileResized(widget, area.top(), area.left(), area.height(), area.width());
+    return true;
+}
+
+// Exchanges the areas of two widgets of the layout, as a single operation: only their own
+// cells are touched, and the widgets are not reparented. Returns false if a widget is not in
+// the layout or if the other area breaks its constraints
+bool QTileLayout::swapWidgets(QWidget *widget, QWidget *other) {
+    QRect area = placementOf(widget);
+    QRect otherArea = placementOf(other);
+    if (!area.isValid() || !otherArea.isValid() || widget == other
+        || !fitsConstraints(widget, otherArea.size()) || !fitsConstraints(other, area.size())) {
+        return false;
+    }
+
+    // The swap is a single change, notified by layoutChanged only
+    commitChanges({{widget, area, otherArea}, {other, otherArea, area}}, false);
+    return true;
+}
+
+// Moves the widget from this layout to the area of the target layout, which is this layout or
+// a linked one, pushing the widgets in the way along the direction if the target allows it.
+// Both layouts are planned before anything changes, then each one applies its changes in a
+// single batch: the target takes the widget, and a source left with a gap is reordered.
+// Returns false, leaving both layouts untouched, if the widget cannot go there
+bool QTileLayout::transferWidget(QWidget *widget, QTileLayout *target, const QRect &area, QPoint direction) {
+    QRect from = placementOf(widget);
+    if (!from.isValid() || !target || linkedLayout.value(target->id) != target) {
+        return false;
+    }
+
+    QVector<PlacementChange> targetChanges;
+    if (target->isAreaFree(area, target == this ? widget : nullptr)) {
+        targetChanges.append({widget, target->placementOf(widget), area});
+    } else if (target->pushing && !direction.isNull()) {
+        targetChanges = target->planPush(widget, area, direction);
+    }
+    if (targetChanges.isEmpty() || !target->canApplyChanges(targetChanges)) {
+        return false;
+    }
+
+    QVector<PlacementChange> sourceChanges;
+    bool reordered = false;
+    if (target != this) {
+        QList<QRect> areas = placedAreas;
+        areas[placementIndex.value(widget)] = QRect();
+        reordered = planReorder(areas, QPoint(-1, -1), sourceChanges);
+        if (!reordered) {
+            sourceChanges = {{widget, from, QRect()}};
+        }
+    }
+
+    beginChange();
+    target->beginChange();
+
+    commitChanges(sourceChanges);
+    if (reordered) {
+        markFlowed(QPoint(-1, -1));
+    }
+    target->commitChanges(targetChanges);
+
+    if (target != this) {
+        linkSteps(target);
+        emit target->tileMoved(widget, getId(), target->getId(), from.top(), from.left(), area.top(), area.left());
+    }
+
+    target->endChange();
+    endChange();
+    return true;
+}
+
+// Checks if the changes can all be applied: each new area in the grid and free once the areas
+// left are freed, without overlapping another new one
+bool QTileLayout::canApplyChanges(const QVector<PlacementChange> &changes) const {
+    TileIndex cells = tileMap;
+    for (const PlacementChange &change : changes) {
+        QRect placed = placementOf(change.widget);
+        if (placed.isValid()) {
+            cells.remove(change.widget, placed);
+        }
+    }
+
+    QRect grid(0, 0, columnNumber, rowNumber);
+    for (const PlacementChange &change : changes) {
+        if (!change.to.isValid()) {
+            continue;
+        }
+        if (!grid.contains(change.to) || !cells.isFree(change.to)) {
+            return false;
+        }
+        cells.insert(change.widget, change.to);
+    }
+    return true;
+}
+
+void QTileLayout::acceptPushing(bool value) {
+    pushing = value;
+}
+
+// Limits how many widgets a push can cascade through
+void QTileLayout::setMaxPushChain(int length) {
+    maxPushChain = length;
+}
+
+// Reverts the last change of the layout
+void QTileLayout::undo() {
+    replayStep(false);
+}
+
+// Applies again the last reverted change of the layout
+void QTileLayout::redo() {
+    replayStep(true);
+}
+
+// Links the steps both layouts are recording: a widget moved from one to the other is undone
+// and redone in both at once
+void QTileLayout::linkSteps(QTileLayout *other) {
+    if (!replaying && !other->replaying) {
+        quint64 link = newStepLink();
+        journal.linkStep(link);
+        other->journal.linkStep(link);
+    }
+}
+
+// Reverts (or applies again if forward) the next step of the layout. A step linked to the
+// steps of other layouts is replayed in all of them, the layouts the widgets leave first.
+// Nothing is replayed if a widget would be put back while another layout still holds it
+void QTileLayout::replayStep(bool forward) {
+    quint64 link = forward ? journal.redoLink() : journal.undoLink();
+    QList<QTileLayout*> layouts{this};
+    for (QTileLayout *layout : qAsConst(linkedLayout)) {
+        if (link && layout != this && (forward ? layout->journal.redoLink() : layout->journal.undoLink()) == link) {
+            layouts.append(layout);
+        }
+    }
+
+    QHash<QTileLayout*, QVector<PlacementChange>> steps;
+    QHash<QWidget*, QTileLayout*> leaving;
+    for (QTileLayout *layout : qAsConst(layouts)) {
+        if (layout->journal.isStepOpen()) {
+            return;
+        }
+        QVector<PlacementChange> changes = forward ? layout->journal.redoChanges() : layout->journal.undoChanges();
+        for (const PlacementChange &change : qAsConst(changes)) {
+            if (!change.to.isValid()) {
+                leaving.insert(change.widget, layout);
+            }
+        }
+        steps.insert(layout, changes);
+    }
+
+    QSet<QTileLayout*> sources;
+    for (QTileLayout *layout : qAsConst(layouts)) {
+        for (const PlacementChange &change : steps.value(layout)) {
+            QTileLayout *owner = change.to.isValid() ? ownerOf(change.widget) : nullptr;
+            if (!owner || owner == layout) {
+                continue;
             }
-            if (!isEmpty) {
-                break;
+            if (leaving.value(change.widget) != owner) {
+                return;
             }
+            sources.insert(owner);
+        }
+    }
+    std::stable_partition(layouts.begin(), layouts.end(), [&sources](QTileLayout *layout) {
+        return sources.contains(layout);
+    });
+
+    for (QTileLayout *layout : qAsConst(layouts)) {
+        layout->replaying = true;
+        layout->commitChanges(forward ? layout->journal.redoStep() : layout->journal.undoStep());
+        layout->replaying = false;
+    }
+}
+
+// The layout holding the widget, among this one and the linked ones
+QTileLayout *QTileLayout::ownerOf(QWidget *widget) const {
+    for (QTileLayout *layout : linkedLayout) {
+        if (layout->placementOf(widget).isValid()) {
+            return layout;
+        }
+    }
+    return nullptr;
+}
+
+bool QTileLayout::canUndo() const {
+    return journal.canUndo();
+}
+
+bool QTileLayout::canRedo() const {
+    return journal.canRedo();
+}
+
+// Caps the memory used by the undo history, the oldest changes are forgotten first
+void QTileLayout::setJournalMemoryLimit(int bytes) {
+    journal.setMemoryLimit(bytes);
+}
+
+// Pushes a command in the stack for each change of the layout: once a stack is set,
+// undo and redo should go through it. Linked layouts should share their stack, a widget
+// moved from one to the other is then a single command
+void QTileLayout::setUndoStack(QUndoStack *stack) {
+    undoStack = stack;
+}
+
+// Groups the following changes in a single operation, until endChange() is called:
+// a single undo step and a single layoutChanged signal
+void QTileLayout::beginChange() {
+    ++changeDepth;
+    if (!replaying) {
+        journal.beginStep();
+    }
+}
+
+void QTileLayout::endChange() {
+    if (!replaying && journal.endStep()) {
+        pushUndoCommand();
+    }
+    if (changeDepth > 0 && --changeDepth == 0) {
+        flushChanges();
+    }
+}
+
+// Emits layoutChanged with the widgets whose area changed during the operation that just ended
+void QTileLayout::flushChanges() {
+    pendingIndex.clear();
+    pendingChanges.erase(
+        std::remove_if(pendingChanges.begin(), pendingChanges.end(), [](const PlacementChange &change) {
+            return change.from == change.to;
+        }),
+        pendingChanges.end()
+        );
+
+    if (!pendingChanges.isEmpty()) {
+        QVector<PlacementChange> changes;
+        changes.swap(pendingChanges);
+        publishSnapshot();
+        emit layoutChanged(changes);
+    }
+}
+
+// Replaces the published snapshot with a copy of the current placements. The readers holding
+// the previous one keep it alive until they let it go
+void QTileLayout::publishSnapshot() {
+    auto next = std::make_shared<TileSnapshot>();
+    const std::shared_ptr<const TileSnapshot> *previous = publishedSnapshot.load();
+    next->version = previous ? (*previous)->version + 1 : 1;
+    next->rowCount = rowNumber;
+    next->columnCount = columnNumber;
+
+    next->placements.reserve(placedWidgets.size());
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        next->placements.append({placedWidgets.at(index), placedWidgets.at(index)->objectName(), placedAreas.at(index)});
+    }
+
+    previous = publishedSnapshot.exchange(new std::shared_ptr<const TileSnapshot>(std::move(next)));
+    if (previous) {
+        retiredSnapshots.append(previous);
+    }
+
+    // A reader announced after the exchange can only load the new pointer: with no reader
+    // announced now, none can still be copying a retired one
+    if (snapshotReaders.load() == 0) {
+        for (const std::shared_ptr<const TileSnapshot> *retired : qAsConst(retiredSnapshots)) {
+            delete retired;
+        }
+        retiredSnapshots.clear();
+    }
+}
+
+void QTileLayout::pushUndoCommand() {
+    if (!undoStack) {
+        return;
+    }
+
+    quint64 link = journal.undoLink();
+    if (link && undoStack->index() > 0) {
+        auto previous = dynamic_cast<const TileUndoCommand*>(undoStack->command(undoStack->index() - 1));
+        if (previous && previous->stepLink() == link) {
+            return;
         }
     }
+    if (!history) {
+        history = new QObject(this);
+    }
+    undoStack->push(new TileUndoCommand(this, history, link));
+}
+
+// Forgets the undo history. The commands the layout pushed in the undo stack are disowned: the
+// changes they revert do not apply to the placements anymore. The other commands of the stack,
+// which may be shared, are kept
+void QTileLayout::clearHistory() {
+    journal.clear();
+    delete history;
+}
+
+// Checks if the given space is free from widgets
+bool QTileLayout::isAreaEmpty(int fromRow, int fromColumn, int rowSpan, int columnSpan, QString color) {
+    if (!color.isEmpty() && colorMap.contains(color)) {
+        changeTilesColor(color);
+    }
+
+    bool isEmpty = isAreaFree(QRect(fromColumn, fromRow, columnSpan, rowSpan));
 
     if (isEmpty && !color.isEmpty() && colorMap.contains(color)) {
         changeTilesColor("empty_check", QPoint(fromRow, fromColumn), QPoint(rowSpan, columnSpan));
@@ -444,40 +1407,155 @@ bool QTileLayout::isAreaEmpty(int fromRow, int fromColumn, int rowSpan, int colu
     return isEmpty;
 }
 
-QWidget* QTileLayout::getWidgetToDrop() {
-    QWidget *widget = widgetToDrop;
-    widgetToDrop = nullptr;
-    return widget;
-}
+// Checks if the area is in the grid and only covers empty cells or cells of the given widget
+bool QTileLayout::isAreaFree(const QRect &area, QWidget *widget) const {
+    if (!QRect(0, 0, columnNumber, rowNumber).contains(area)) {
+        return false;
+    }
 
-void QTileLayout::setWidgetToDrop(QWidget *widget) {
-    widgetToDrop = widget;
+    return tileMap.isFree(area, widget);
 }
 
-// Changes the color of all tiles
+// Changes the colour of the empty tiles: the whole grid if toTile is null, else the rowSpan
+// x columnSpan area given by toTile. The tiles covered by a widget keep the idle colour
 void QTileLayout::changeTilesColor(QString colorChoice, QPoint fromTile, QPoint toTile) {
-    QPalette * palette = new QPalette();
-    palette->setColor(QPalette::Window, colorMap.value(colorChoice));
-    QPalette * paletteIdle = new QPalette();
-    paletteIdle->setColor(QPalette::Window, colorMap.value("idle"));
-    QPoint toTileAdjusted = toTile.isNull() ? QPoint(rowNumber, columnNumber) : toTile;
+    if (!overlay) {
+        return;
+    }
 
-    for (int row = fromTile.x(); row < fromTile.x() + toTileAdjusted.x(); ++row)
-    {
-        for (int column = fromTile.y(); column < fromTile.y() + toTileAdjusted.y(); ++column)
-        {
-            if (!tileMap[row][column]->isFilled())
-            {
-                tileMap[row][column]->changeColor(*palette);
-            }
-            else
-            {
-                tileMap[row][column]->changeColor(*paletteIdle);
+    if (toTile.isNull()) {
+        overlay->setBaseColor(colorMap.value(colorChoice));
+    } else {
+        overlay->setHighlight(QRect(fromTile.y(), fromTile.x(), toTile.y(), toTile.x()), colorMap.value(colorChoice));
+    }
+}
+
+// Places the widgets in a single pass: each one gets the geometry of its area
+void QTileLayout::setGeometry(const QRect &rect) {
+    QLayout::setGeometry(rect);
+    attachParentWidget();
+
+    // Crossing a breakpoint rearranges the widgets before they are placed, in the same pass
+    int breakpoint = breakpointFor(rect.width());
+    if (breakpoint != currentBreakpoint) {
+        switchBreakpoint(breakpoint);
+    }
+
+    for (int index = 0; index < placedItems.size(); ++index) {
+        placedItems.at(index)->setGeometry(areaRect(placedAreas.at(index)));
+    }
+
+    if (overlay) {
+        overlay->setGeometry(rect);
+    }
+    updateLazyWidgets();
+}
+
+// Adds the widget of the item at the first empty cell, as a 1x1 tile
+void QTileLayout::addItem(QLayoutItem *item) {
+    QWidget *widget = item->widget();
+    delete item;
+
+    for (int row = 0; row < rowNumber && widget; ++row) {
+        for (int column = 0; column < columnNumber; ++column) {
+            if (!tileMap.widgetAt(row, column)) {
+                addWidget(widget, row, column);
+                return;
             }
-            // qDebug() << "changeTilesColor: Row" << row<< "Column" << column << tileMap[row][column]->getInfo();
         }
     }
 
+    qWarning() << "QTileLayout::addItem: only widgets can be added, in an empty cell";
+}
+
+QLayoutItem *QTileLayout::itemAt(int index) const {
+    return placedItems.value(index);
+}
+
+// Takes the item out of the layout, its cells become empty
+QLayoutItem *QTileLayout::takeAt(int index) {
+    if (index < 0 || index >= placedItems.size()) {
+        return nullptr;
+    }
+
+    QRect area = placedAreas.takeAt(index);
+    QWidget *widget = placedWidgets.takeAt(index);
+    tileMap.remove(widget, area);
+    QLayoutItem *item = placedItems.takeAt(index);
+
+    // The widgets after the taken one move down in the lists
+    placementIndex.remove(widget);
+    for (int next = index; next < placedWidgets.size(); ++next) {
+        placementIndex[placedWidgets.at(next)] = next;
+    }
+
+    if (!takingTile) {
+        // Qt takes out a widget deleted or reparented: the change is notified and published,
+        // but not journaled, undoing it would take the widget back from its new owner
+        bool wasReplaying = replaying;
+        replaying = true;
+        recordChange(widget, area, QRect());
+        replaying = wasReplaying;
+    } else if (overlay) {
+        overlay->updateCells(area);
+    }
+    return item;
+}
+
+int QTileLayout::count() const {
+    return placedItems.size();
+}
+
+// The cells have a fixed size: the layout takes exactly the room of the grid
+QSize QTileLayout::sizeHint() const {
+    QMargins margins = contentsMargins();
+    return QSize(
+        columnNumber * horizontalSpan + qMax(0, columnNumber - 1) * horizontalGap + margins.left() + margins.right(),
+        rowNumber * verticalSpan + qMax(0, rowNumber - 1) * verticalGap + margins.top() + margins.bottom()
+        );
+}
+
+// With breakpoints, the layout can be given less width than its grid, down to the grid of the
+// breakpoint with the fewest columns: it then switches to the breakpoint of the width it gets
+QSize QTileLayout::minimumSize() const {
+    QSize size = sizeHint();
+    if (breakpoints.isEmpty()) {
+        return size;
+    }
+
+    int columns = columnNumber;
+    for (const Breakpoint &breakpoint : breakpoints) {
+        columns = qMin(columns, breakpoint.columnNumber);
+    }
+    QMargins margins = contentsMargins();
+    size.setWidth(columns * horizontalSpan + qMax(0, columns - 1) * horizontalGap + margins.left() + margins.right());
+    return size;
+}
+
+Qt::Orientations QTileLayout::expandingDirections() const {
+    return {};
+}
+
+// Installs the interaction and the grid painting on the parent widget, once it is known
+void QTileLayout::attachParentWidget() {
+    QWidget *parent = parentWidget();
+    if (!parent || parent == container) {
+        return;
+    }
+
+    container = parent;
+    container->installEventFilter(this);
+    container->setAcceptDrops(true);
+    // The hover moves reach the parent widget wherever the mouse is, over the placed widgets
+    // too, without turning on their mouse tracking
+    container->setAttribute(Qt::WA_Hover);
+
+    overlay = new TileOverlay(this, container);
+    overlay->setIdleColor(colorMap.value("idle"));
+    overlay->setSelectionColor(colorMap.value("selection"));
+    overlay->setBaseColor(colorMap.value("idle"));
+    overlay->lower();
+    overlay->show();
 }
 
 // returns a 1D list given a 2D list
@@ -506,200 +1584,424 @@ void QTileLayout::updateGlobalSize(QResizeEvent *newSize) {
         static_cast<int>((newSize->size().width() - (columnNumber - 1) * horizontalSpacing() - horizontalMargins) / columnNumber)
         );
 
-    updateAllTiles();
+    invalidate();
 }
 
-// Merges the tilesToMerge with tile
-void QTileLayout::mergeTiles(Tile *tile, int fromRow, int fromColumn, int rowSpan, int columnSpan, QList<QPoint> tilesToMerge) {
-    for (const QPoint &point : std::as_const(tilesToMerge)) {
-        if (tileMap[point.x()][point.y()])
-        {
-            QGridLayout::removeWidget(tileMap[point.x()][point.y()]);
-            delete tileMap[point.x()][point.y()];
-        }
-        tileMap[point.x()][point.y()] = tile;
+// Gives the area to the placed widget at index, its geometry follows immediately
+void QTileLayout::placeTile(int index, const QRect &area) {
+    placedAreas[index] = area;
+    tileMap.insert(placedWidgets.at(index), area);
+    if (geometry().isValid()) {
+        placedItems.at(index)->setGeometry(areaRect(area));
+    }
+}
+
+// Moves a placed widget to the target area if it is free: only its own cells are touched
+bool QTileLayout::relocateTile(QWidget *widget, const QRect &target) {
+    int index = placementIndex.value(widget, -1);
+    if (index < 0 || !isAreaFree(target, widget)) {
+        return false;
     }
 
-    QGridLayout::removeWidget(tile);
-    QGridLayout::addWidget(tile, fromRow, fromColumn, rowSpan, columnSpan);
-    tile->updateSize(fromRow, fromColumn, rowSpan, columnSpan);
+    tileMap.remove(widget, placedAreas.at(index));
+    placeTile(index, target);
+    return true;
+}
+
+// Puts the widget in the layout over the area. The widget is only reparented if it comes
+// from another parent widget (a drop from a linked layout): moving a native or OpenGL
+// widget to another parent recreates its surface
+void QTileLayout::insertTile(QWidget *widget, const QRect &area) {
+    if (widget->parentWidget() != parentWidget()) {
+        addChildWidget(widget);
+    }
+    placementIndex.insert(widget, placedWidgets.size());
+    placedWidgets.append(widget);
+    placedAreas.append(area);
+    placedItems.append(new QWidgetItem(widget));
+    placeTile(placedWidgets.size() - 1, area);
+
+    // A widget taken out of the layout before is hidden
+    if (widget->isHidden() && parentWidget()) {
+        widget->show();
+    }
 }
 
-// Splits the tilesToSplit from tile
-void QTileLayout::splitTiles(Tile *tile, int fromRow, int fromColumn, int rowSpan, int columnSpan, QList<QPoint> tilesToSplit) {
-    for (const QPoint &point : std::as_const(tilesToSplit)) {
-        qDebug() << __FUNCTION__ << tilesToSplit << point.x() << point.y();
-        createTile(point.x(), point.y(), 1, 1, true);
+// Takes the widget out of the layout and hides it, the cells become empty. The widget keeps
+// its parent so that it can come back without being reparented.
+// Returns the area the widget was covering
+QRect QTileLayout::takeTile(QWidget *widget) {
+    int index = placementIndex.value(widget, -1);
+    if (index < 0) {
+        return QRect();
     }
 
-    QGridLayout::removeWidget(tile);
-    QGridLayout::addWidget(tile, fromRow, fromColumn, rowSpan, columnSpan);
-    tile->updateSize(fromRow, fromColumn, rowSpan, columnSpan);
+    QRect area = placedAreas.at(index);
+    takingTile = true;
+    delete takeAt(index);
+    takingTile = false;
+
+    widget->hide();
+    return area;
 }
 
-// Creates a tile: a tile is basically a place holder that can contain a widget or not
-Tile* QTileLayout::createTile(int fromRow, int fromColumn, int rowSpan, int columnSpan, bool updateTileMap) {
-    Tile *tile = new Tile(
-        this,
-        fromRow,
-        fromColumn,
-        rowSpan,
-        columnSpan,
-        verticalSpan,
-        horizontalSpan
-        );
+// Takes the widgets flagged in removed (by placement index) out of the layout in one pass
+// over the placements, as a single operation with a single recolouring.
+// Returns the removed widgets, or nothing if they are deleted
+QList<QWidget*> QTileLayout::takeTiles(const QVector<bool> &removed, bool deleteWidgets) {
+    QList<QWidget*> widgets;
+    QVector<PlacementChange> changes;
+    int kept = 0;
+
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        QWidget *widget = placedWidgets.at(index);
+        if (!removed.value(index)) {
+            // The kept placements are compacted at the front of the lists
+            placedWidgets[kept] = widget;
+            placedAreas[kept] = placedAreas.at(index);
+            placedItems[kept] = placedItems.at(index);
+            placementIndex[widget] = kept;
+            ++kept;
+            continue;
+        }
 
-    QGridLayout::addWidget(tile, fromRow, fromColumn, rowSpan, columnSpan);
+        placementIndex.remove(widget);
+        tileMap.remove(widget, placedAreas.at(index));
+        delete placedItems.at(index);
+        widget->hide();
+        changes.append({widget, placedAreas.at(index), QRect()});
+        widgets.append(widget);
+    }
 
-    if (updateTileMap) {
-        QVector<QPoint> tilePositions;
-        for (int row = 0; row < rowSpan; row++) {
-            for (int column = 0; column < columnSpan; column++) {
-                tilePositions.append(QPoint(fromRow + row, fromColumn + column));
-            }
+    if (changes.isEmpty()) {
+        return widgets;
+    }
+
+    placedWidgets.erase(placedWidgets.begin() + kept, placedWidgets.end());
+    placedAreas.erase(placedAreas.begin() + kept, placedAreas.end());
+    placedItems.erase(placedItems.begin() + kept, placedItems.end());
+
+    beginChange();
+    for (const PlacementChange &change : qAsConst(changes)) {
+        recordChange(change.widget, change.from, change.to);
+    }
+    changeTilesColor("idle");
+    endChange();
+
+    if (deleteWidgets) {
+        for (QWidget *widget : qAsConst(widgets)) {
+            widget->deleteLater();
         }
+        widgets.clear();
+    }
+    return widgets;
+}
+
+// Records a change in the journal (and in the undo stack once its step is complete),
+// and in the changes notified at the end of the current operation
+void QTileLayout::recordChange(QWidget *widget, const QRect &from, const QRect &to) {
+    if (!replaying && journal.record(widget, from, to)) {
+        pushUndoCommand();
+    }
+
+    // Successive changes of the same widget in one operation are merged
+    auto pending = pendingIndex.constFind(widget);
+    if (pending != pendingIndex.constEnd()) {
+        pendingChanges[*pending].to = to;
+    } else {
+        pendingIndex.insert(widget, pendingChanges.size());
+        pendingChanges.append({widget, from, to});
+    }
 
-        for (const auto& position : tilePositions) {
-            int row = position.x();
-            int column = position.y();
-            tileMap[row][column] = tile;
+    if (overlay && !holdOverlay) {
+        overlay->updateCells(from | to);
+    }
+
+    // The drop anchors only hold for the placements they were computed on, the last flow for
+    // the cells before the change
+    dropAnchors.clear();
+    markFlowDirty(from);
+    markFlowDirty(to);
+
+    if (changeDepth == 0) {
+        flushChanges();
+    }
+}
+
+// Applies a batch of changes: each one only touches the cells of its own areas. The tileMoved and
+// tileResized signals are emitted for each widget if placementSignals is set
+void QTileLayout::applyChanges(const QVector<PlacementChange> &changes, bool placementSignals) {
+    // The areas left are all freed before the new ones are filled, so that they never collide
+    for (const PlacementChange &change : changes) {
+        int index = placementIndex.value(change.widget, -1);
+        if (index >= 0) {
+            tileMap.remove(change.widget, placedAreas.at(index));
         }
     }
 
-    return tile;
+    for (const PlacementChange &change : changes) {
+        int index = placementIndex.value(change.widget, -1);
+        if (!change.to.isValid()) {
+            takeTile(change.widget);
+        } else if (index >= 0) {
+            placeTile(index, change.to);
+        } else if (isAreaFree(change.to) && !(replaying && ownerOf(change.widget))) {
+            // A replayed step never takes a widget from another layout
+            insertTile(change.widget, change.to);
+        }
+    }
+
+    if (placementSignals) {
+        for (const PlacementChange &change : changes) {
+            emitPlacementSignal(change);
+        }
+    }
 }
 
-// Recovers the tiles that will be merged or split during resizing
-std::tuple<QList<QPoint>, bool, int, int, int, int> QTileLayout::getTilesToBeResized(Tile *tile, QPoint direction, int fromRow, int fromColumn, int tileNumber) {
-    int rowSpan = tile->getRowSpan();
-    int columnSpan = tile->getColumnSpan();
-    bool increase = true;
-    int dirX = direction.x();
-    int dirY = direction.y();
-    QList<QPoint> tilesToMerge;
-    int newTileNumber; // Nuova variabile per memorizzare tileNumber
+// Emits tileMoved or tileResized for a widget staying in the layout
+void QTileLayout::emitPlacementSignal(const PlacementChange &change) {
+    if (!change.from.isValid() || !change.to.isValid() || change.from == change.to) {
+        return;
+    }
+
+    if (change.from.size() == change.to.size()) {
+        emit tileMoved(change.widget, getId(), getId(), change.from.top(), change.from.left(), change.to.top(), change.to.left());
+    } else {
+        emit tileResized(change.widget, change.to.top(), change.to.left(), change.to.height(), change.to.width());
+    }
+}
 
-    // Increase tile size
-    if (tileNumber * (dirX + dirY) > 0) {
-        auto res = getTilesToMerge(direction, fromRow, fromColumn, tileNumber);
-        newTileNumber = std::get<0>(res); // Assegna il valore di tileNumber dalla tupla restituita
-        tilesToMerge = std::get<1>(res);
-    } else { // Decrease tile size
-        // std::tie(newTileNumber, tilesToMerge)
-        auto res = getTilesToSplit(direction, fromRow, fromColumn, tileNumber);
-        newTileNumber = std::get<0>(res); // Assegna il valore di tileNumber dalla tupla restituita
-        tilesToMerge = std::get<1>(res);
-        increase = false;
+// Applies a batch of changes as a single operation
+void QTileLayout::commitChanges(const QVector<PlacementChange> &changes, bool placementSignals) {
+    beginChange();
+    for (const PlacementChange &change : changes) {
+        recordChange(change.widget, change.from, change.to);
     }
+    applyChanges(changes, placementSignals);
+    endChange();
+}
 
-    columnSpan += newTileNumber * dirX; // Usa newTileNumber
-    fromColumn += newTileNumber * (dirX == -1); // Usa newTileNumber
-    rowSpan += newTileNumber * dirY; // Usa newTileNumber
-    fromRow += newTileNumber * (dirY == -1); // Usa newTileNumber
+// Returns the area after its edge in the given direction moved by tileNumber, within the grid
+QRect QTileLayout::grownArea(const QRect &area, QPoint direction, int tileNumber) const {
+    if (direction.isNull()) {
+        return area;
+    }
 
-    return std::make_tuple(tilesToMerge, increase, fromRow, fromColumn, rowSpan, columnSpan);
+    return visitEdge(direction, [&](auto tag) {
+        return shiftedEdge<decltype(tag)::value>(area, tileNumber).intersected(QRect(0, 0, columnNumber, rowNumber));
+    });
 }
 
-// Finds the tiles to split when a tile is decreased
-std::tuple<int, QList<QPoint> > QTileLayout::getTilesToSplit(QPoint direction, int fromRow, int fromColumn, int tileNumber) {
-    Tile* tile = tileMap[fromRow][fromColumn];
-    int rowSpan = tile->getRowSpan();
-    int columnSpan = tile->getColumnSpan();
-    int dirX = direction.x();
-    int dirY = direction.y();
+// Returns the area of the widget once its edge in the given direction moved by tileNumber:
+// it grows until it meets another widget or the end of the grid, and keeps at least one cell.
+// Growing only checks the strip of cells the edge moves over at each step. The span
+// constraints of the widget are then applied, see constrainedArea()
+QRect QTileLayout::resizedArea(QWidget *widget, QPoint direction, int tileNumber) const {
+    QRect area = placementOf(widget);
+    if (direction.isNull()) {
+        return area;
+    }
+
+    QRect resized = visitEdge(direction, [&](auto tag) {
+        constexpr Edge edge = decltype(tag)::value;
+        int cells = tileNumber * outwards<edge>;
+
+        if (cells <= 0) {
+            int span = horizontal<edge> ? area.width() : area.height();
+            return shiftedEdge<edge>(area, -outwards<edge> * qMin(-cells, span - 1));
+        }
+
+        QRect grown = area;
+        for (int step = 0; step < cells && isAreaFree(outerStrip<edge>(grown)); ++step) {
+            grown = shiftedEdge<edge>(grown, outwards<edge>);
+        }
+        return grown;
+    });
+    return constrainedArea(widget, resized, direction);
+}
 
-    int newTileNumber = (-tileNumber * (dirX + dirY) < columnSpan * (dirX != 0) + rowSpan * (dirY != 0)) ? tileNumber :
-                        (1 - columnSpan) * dirX + (1 - rowSpan) * dirY;
+// Plans how the widgets in the way of the target area are pushed along the direction, cascading.
+// Returns the changes ordered so that they can be applied one after the other without collision
+// (the widget the furthest away first, the given widget last), or nothing if the push goes out
+// of the grid or through more than maxPushChain widgets
+QVector<PlacementChange> QTileLayout::planPush(QWidget *widget, const QRect &target, QPoint direction) const {
+    struct Push {
+        QWidget *widget;
+        QRect from;
+        QRect to;
+        int chain;
+    };
 
+    // The sweep works in a frame where the push always goes towards increasing columns
+    bool vertical = direction.y() != 0;
+    bool backward = direction.x() + direction.y() < 0;
+    int limit = vertical ? rowNumber : columnNumber;
 
-    QList<QPoint> tilesToMerge;
-    for (int row = 0; row < (-tileNumber * dirY + rowSpan * (dirX != 0)); ++row) {
-        for (int column = 0; column < (-tileNumber * dirX + columnSpan * (dirY != 0)); ++column) {
-            int newRow = fromRow + row + (rowSpan - 2 * row - 1) * (dirY == 1);
-            int newColumn = fromColumn + column + (columnSpan - 2 * column - 1) * (dirX == 1);
-            tilesToMerge.push_back(QPoint(newRow, newColumn));
+    auto toFrame = [=](const QRect &area) {
+        QRect framed = vertical ? QRect(area.top(), area.left(), area.height(), area.width()) : area;
+        if (backward) {
+            framed.moveLeft(limit - 1 - framed.right());
+        }
+        return framed;
+    };
+    auto fromFrame = [=](QRect framed) {
+        if (backward) {
+            framed.moveLeft(limit - 1 - framed.right());
         }
+        return vertical ? QRect(framed.top(), framed.left(), framed.height(), framed.width()) : framed;
+    };
+
+    if (direction.isNull() || !QRect(0, 0, columnNumber, rowNumber).contains(target)) {
+        return {};
     }
 
-    return std::make_tuple(newTileNumber, tilesToMerge);
-}
+    QRect source;
+
+    QVector<Push> moved = {{widget, QRect(), toFrame(target), 0}};
+    QVector<Push> others;
+    for (int i = 0; i < placedWidgets.size(); ++i) {
+        QRect area = placedAreas.at(i);
+        if (placedWidgets.at(i) == widget) {
+            source = area;
+        } else if (toFrame(area).right() >= moved.first().to.left()) {
+            // The widgets behind the target can never be reached
+            others.append({placedWidgets.at(i), toFrame(area), QRect(), 0});
+        }
+    }
 
-// Finds the tiles to merge when a tile is increased
-std::tuple<int, QList<QPoint>> QTileLayout::getTilesToMerge(QPoint direction, int fromRow, int fromColumn, int tileNumber) {
-    Tile* tile = tileMap[fromRow][fromColumn];
-    int rowSpan = tile->getRowSpan();
-    int columnSpan = tile->getColumnSpan();
-    int tileNumberAvailable = 0;
-    QList<QPoint> tilesToMerge;
-    int dirX = direction.x();
-    int dirY = direction.y();
+    std::sort(others.begin(), others.end(), [](const Push &a, const Push &b) {
+        return a.from.left() < b.from.left();
+    });
 
-    if (dirX + dirY == -1) {
-        tileNumber = qMax(tileNumber, -fromColumn * (dirX != 0) - fromRow * (dirY != 0));
-    } else {
-        int minTileNumber = ((columnNumber - fromColumn - columnSpan) * (dirX != 0) +
-                             (rowNumber - fromRow - rowSpan) * (dirY != 0));
-        tileNumber = qMin(tileNumber, minTileNumber);
-    }
-
-    // Ovest o Est
-    if (dirX != 0) {
-        for (int column = 0; column < tileNumber * dirX; ++column) {
-            QList<QPoint> tilesToCheck;
-            int columnDelta = (columnSpan + column) * (dirX == 1) + (-column - 1) * (dirX == -1);
-            for (int row = 0; row < rowSpan; ++row) {
-                tilesToCheck.append(QPoint(fromRow + row, fromColumn + columnDelta));
-                if (tileMap[fromRow + row][fromColumn + columnDelta]->isFilled()) {
-                    return std::make_tuple(tileNumberAvailable, tilesToMerge);
+    for (const Push &other : qAsConst(others)) {
+        QRect area = other.from;
+        int chain = 0;
+        bool shifted = true;
+
+        while (shifted) {
+            shifted = false;
+            for (const Push &push : qAsConst(moved)) {
+                if (push.to.intersects(area)) {
+                    area.moveLeft(push.to.right() + 1);
+                    chain = qMax(chain, push.chain + 1);
+                    shifted = true;
                 }
             }
-            tileNumberAvailable += dirX;
-            tilesToMerge.append(tilesToCheck);
-        }
-    }
-    // Nord o Sud
-    else {
-        for (int row = 0; row < tileNumber * dirY; ++row) {
-            QList<QPoint> tilesToCheck;
-            int rowDelta = (rowSpan + row) * (dirY == 1) + (-row - 1) * (dirY == -1);
-            for (int column = 0; column < columnSpan; ++column) {
-                tilesToCheck.append(QPoint(fromRow + rowDelta, fromColumn + column));
-                if (tileMap[fromRow + rowDelta][fromColumn + column]->isFilled()) {
-                    return std::make_tuple(tileNumberAvailable, tilesToMerge);
-                }
+        }
+
+        if (area != other.from) {
+            if (area.right() >= limit || chain > maxPushChain) {
+                return {};
             }
-            tileNumberAvailable += dirY;
-            tilesToMerge.append(tilesToCheck);
+            moved.append({other.widget, other.from, area, chain});
         }
     }
-    return std::make_tuple(tileNumberAvailable, tilesToMerge);
+
+    std::sort(moved.begin() + 1, moved.end(), [](const Push &a, const Push &b) {
+        return a.to.left() > b.to.left();
+    });
+
+    QVector<PlacementChange> changes;
+    for (int i = 1; i < moved.size(); ++i) {
+        changes.append({moved[i].widget, fromFrame(moved[i].from), fromFrame(moved[i].to)});
+    }
+    changes.append({widget, source, target});
+    return changes;
 }
 
+// Creates the lazy widgets near the visible part of the parent widget, and hibernates or
+// destroys the ones far from it according to the lazy policy
+void QTileLayout::updateLazyWidgets() {
+    if (lazyTiles.isEmpty() || !container || !container->isVisible()) {
+        return;
+    }
 
-// Creates a map to be able to locate each tile on the grid
-void QTileLayout::createTileMap() {
-    for (int row = 0; row < rowNumber; ++row) {
-        QList<Tile*> rowTiles;
-        for (int column = 0; column < columnNumber; ++column) {
-            Tile* tile = createTile(row, column);
-            rowTiles.push_back(tile);
+    QRect visible = container->visibleRegion().boundingRect();
+    if (visible.isEmpty()) {
+        return;
+    }
+
+    QRect prefetched = visible.adjusted(-prefetchMargin, -prefetchMargin, prefetchMargin, prefetchMargin);
+    int margin = qMax(releaseMargin, prefetchMargin);
+    QRect kept = visible.adjusted(-margin, -margin, margin, margin);
+
+    // The tiles removed from the layout or deleted are forgotten on the way
+    lazyTiles.erase(
+        std::remove_if(lazyTiles.begin(), lazyTiles.end(), [](const QPointer<LazyTile> &tile) {
+            return tile.isNull();
+        }),
+        lazyTiles.end()
+        );
+
+    for (const QPointer<LazyTile> &tile : qAsConst(lazyTiles)) {
+        QRect area = placementOf(tile);
+        if (!area.isValid()) {
+            continue;
+        }
+
+        QRect rect = areaRect(area);
+        if (rect.intersects(prefetched)) {
+            tile->materialize();
+        } else if (!rect.intersects(kept)) {
+            if (lazyPolicy == HibernateLazyWidgets) {
+                tile->hibernate();
+            } else if (lazyPolicy == DestroyLazyWidgets) {
+                tile->release();
+            }
         }
-        tileMap.push_back(rowTiles);
     }
 }
 
-// Forces the tiles to update their geometry
-void QTileLayout::updateAllTiles() {
-    if (!tileMap.isEmpty()) {
-        for (int row = 0; row < rowNumber; ++row) {
-            for (int column = 0; column < columnNumber; ++column) {
-                tileMap[row][column]->updateSize(row, column, -1, -1, verticalSpan, horizontalSpan);
-            }
+// Updates the lazy widgets once control is back to the event loop: adding many lazy widgets
+// in a row costs a single pass over them
+void QTileLayout::scheduleLazyUpdate() {
+    if (lazyUpdateScheduled) {
+        return;
+    }
+
+    lazyUpdateScheduled = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        lazyUpdateScheduled = false;
+        updateLazyWidgets();
+    }, Qt::QueuedConnection);
+}
+
+// Turns the updates of the placed widgets off, if asked to during interactions. The widgets
+// whose updates were already off are left alone
+void QTileLayout::freezeWidgets() {
+    if (!freezeUpdates || !frozenWidgets.isEmpty()) {
+        return;
+    }
+
+    for (QWidget *widget : qAsConst(placedWidgets)) {
+        if (widget->updatesEnabled()) {
+            widget->setUpdatesEnabled(false);
+            frozenWidgets.append(widget);
         }
     }
 }
 
-QMap<QUuid, QTileLayout *> QTileLayout::getLinkedLayout() const {
+// Turns the updates of the frozen widgets back on, Qt paints each of them once
+void QTileLayout::thawWidgets() {
+    for (const QPointer<QWidget> &widget : qAsConst(frozenWidgets)) {
+        if (widget) {
+            widget->setUpdatesEnabled(true);
+        }
+    }
+    frozenWidgets.clear();
+}
+
+// Creates a map to be able to locate each widget on the grid, from the placements
+void QTileLayout::createTileMap() {
+    flowDirty = QPoint(0, 0);
+    flowReserved = QPoint(-1, -1);
+    tileMap.reset(rowNumber, columnNumber, tileMap.isSparse());
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        tileMap.insert(placedWidgets.at(index), placedAreas.at(index));
+    }
+}
+
+const QMap<QUuid, QTileLayout *> &QTileLayout::getLinkedLayout() const {
     return linkedLayout;
 }
 
@@ -727,87 +2029,1226 @@ bool QTileLayout::getResizable() const {
     return resizable;
 }
 
+bool QTileLayout::getPushing() const {
+    return pushing;
+}
+
 bool QTileLayout::getDragAndDrop() const {
     return dragAndDrop;
 }
 
+// Flows the widgets back in the grid with their spans, following the auto flow mode, leaving
+// the target cell free. Nothing changes if a widget does not fit anymore
+void QTileLayout::reorderWidgets(const QByteArray &mimeData, int targetRow, int targetColumn) {
+    Q_UNUSED(mimeData);
 
+    QPoint reserved(targetColumn, targetRow);
+    QVector<PlacementChange> changes;
+    if (!planReorder(placedAreas, reserved, changes)) {
+        return;
+    }
 
-// void QTileLayout::setTileVisible(bool visible)
-// {
-//     for (int row = 0; row < rowNumber; ++row) {
-//         for (int column = 0; column < columnNumber; ++column) {
-//             tileMap[row][column]->setVisible(visible);
-//         }
-//     }
-// }
-
-// QList<QTileLayout*> QTileLayout::getLinkedLayouts() const
-// {
-//     return linkedLayout.values();
-// }
-
-// QList<Tile*> QTileLayout::getTileList() const
-// {
-//     QList<Tile*> tiles;
-//     for (int row = 0; row < rowNumber; ++row) {
-//         for (int column = 0; column < columnNumber; ++column) {
-//             tiles.append(tileMap[row][column]);
-//         }
-//     }
-//     return tiles;
-// }
-void QTileLayout::reorderWidgets(const QByteArray &mimeData, int targetRow, int targetColumn) {
-    // Get all widgets and tiles
-    QList<QWidget*> widgets = widgetTileCouple["widget"];
-    QList<QWidget*> tiles = widgetTileCouple["tile"];
-    
-    // Create pairs for sorting
-    QList<QPair<int, QWidget*>> sortedWidgets;
-    for (int i = 0; i < widgets.size(); ++i) {
-        Tile* tile = dynamic_cast<Tile*>(tiles[i]);
-        if (tile) {
-            int pos = tile->getFromRow() * columnNumber + tile->getFromColumn();
-            sortedWidgets.append(qMakePair(pos, widgets[i]));
-        }
-    }
-    
-    // Sort by position to ensure flow order
-    std::sort(sortedWidgets.begin(), sortedWidgets.end(), [](const QPair<int, QWidget*> &a, const QPair<int, QWidget*> &b) {
-        return a.first < b.first;
-    });
-    
-    // Detach all widgets
-    for (int i = 0; i < tiles.size(); ++i) {
-        Tile* tile = dynamic_cast<Tile*>(tiles[i]);
-        if (tile) {
-            tile->releaseWidget();
-        }
-    }
-    
-    // Clear lists
-    widgetTileCouple["widget"].clear();
-    widgetTileCouple["tile"].clear();
-    
-    // Re-add widgets
-    int widgetIndex = 0;
-    for (int row = 0; row < rowNumber; ++row) {
-        for (int column = 0; column < columnNumber; ++column) {
-            // Skip the target tile if valid
-            if (targetRow != -1 && targetColumn != -1 && row == targetRow && column == targetColumn) {
+    // The whole reordering is a single operation
+    if (!changes.isEmpty()) {
+        commitChanges(changes);
+    }
+    markFlowed(reserved);
+}
+
+// Chooses how the widgets are flowed back by reorderWidgets(), the compaction after a transfer
+// and the reflow of a breakpoint: row by row or column by column, leaving the holes behind,
+// or dense, filling the first hole each widget fits in
+void QTileLayout::setAutoFlow(AutoFlow flow) {
+    flowMode = flow;
+    flowDirty = QPoint(0, 0);
+    flowReserved = QPoint(-1, -1);
+}
+
+QTileLayout::AutoFlow QTileLayout::autoFlow() const {
+    return flowMode;
+}
+
+// Plans the changes bringing the widgets from their current areas to the given ones flowed back
+// in the grid, see flowAreas(). Returns false if a widget does not fit anymore.
+// In a row or column flow, a widget only depends on the ones before it: the layout is only
+// flowed again from the first cell changed since the last flow, or reserved by it or this one
+bool QTileLayout::planReorder(const QList<QRect> &areas, const QPoint &reserved, QVector<PlacementChange> &changes) const {
+    QPoint start(-1, -1);
+    if (flowMode == RowFlow || flowMode == ColumnFlow) {
+        start = flowDirty.x() < 0 ? QPoint(columnNumber, rowNumber) : flowDirty;
+        for (const QPoint &cell : {flowReserved, reserved}) {
+            if (cell.x() >= 0 && cell.y() >= 0 && flowsBefore(cell, start)) {
+                start = cell;
+            }
+        }
+        for (int index = 0; index < areas.size(); ++index) {
+            if (areas.at(index) == placedAreas.at(index)) {
                 continue;
             }
-            
-            if (widgetIndex < sortedWidgets.size()) {
-                QWidget* widget = sortedWidgets[widgetIndex].second;
-                Tile* tile = tileMap[row][column];
-                
-                tile->addWidget(widget);
-                widgetTileCouple["widget"].append(widget);
-                widgetTileCouple["tile"].append(tile);
-                
-                widgetIndex++;
+            for (const QRect &area : {areas.at(index), placedAreas.at(index)}) {
+                if (area.isValid() && flowsBefore(area.topLeft(), start)) {
+                    start = area.topLeft();
+                }
             }
         }
     }
+
+    QVector<QRect> flowed = flowAreas(areas, columnNumber, rowNumber, reserved, start);
+    if (flowed.size() != placedWidgets.size()) {
+        return false;
+    }
+
+    changes.clear();
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        if (flowed.at(index) != placedAreas.at(index)) {
+            changes.append({placedWidgets.at(index), placedAreas.at(index), flowed.at(index)});
+        }
+    }
+    return true;
+}
+
+// Checks if the cell comes before the other one in the order of the auto flow mode
+bool QTileLayout::flowsBefore(const QPoint &cell, const QPoint &other) const {
+    return flowMode == ColumnFlow || flowMode == DenseColumnFlow
+        ? qMakePair(cell.x(), cell.y()) < qMakePair(other.x(), other.y())
+        : qMakePair(cell.y(), cell.x()) < qMakePair(other.y(), other.x());
+}
+
+// Brings the first cell to flow again back to the top left cell of the changed area
+void QTileLayout::markFlowDirty(const QRect &area) {
+    if (area.isValid() && (flowDirty.x() < 0 || flowsBefore(area.topLeft(), flowDirty))) {
+        flowDirty = area.topLeft();
+    }
+}
+
+// Records a successful flow, which left the reserved cell free
+void QTileLayout::markFlowed(const QPoint &reserved) {
+    flowDirty = QPoint(-1, -1);
+    flowReserved = reserved.x() >= 0 && reserved.y() >= 0 ? reserved : QPoint(-1, -1);
+}
+
+// Flows the areas, one for each placed widget, in the order of their places along the flow
+// (see setAutoFlow()): each one goes at the first place where it fits, after the previous one
+// or from the start of the grid in a dense flow, keeping its spans (cut to the grid). A null
+// area stays null. The reserved cell, x being the column, is left free. The areas before the
+// start cell in the flow order keep their place, the flow goes on after them. With rows < 0,
+// rows are added as needed and the flow goes row by row.
+// Returns the flowed areas, or nothing if one does not fit
+QVector<QRect> QTileLayout::flowAreas(const QList<QRect> &areas, int columns, int rows, const QPoint &reserved, const QPoint &start) const {
+    bool byColumn = rows >= 0 && (flowMode == ColumnFlow || flowMode == DenseColumnFlow);
+    bool dense = flowMode == DenseRowFlow || flowMode == DenseColumnFlow;
+
+    // The flow works in a frame where it always goes along a row before the next one
+    auto toFrame = [byColumn](const QRect &area) {
+        return byColumn ? QRect(area.top(), area.left(), area.height(), area.width()) : area;
+    };
+    auto flowKey = [byColumn](const QPoint &cell) {
+        return byColumn ? qMakePair(cell.x(), cell.y()) : qMakePair(cell.y(), cell.x());
+    };
+
+    QVector<int> order;
+    order.reserve(areas.size());
+    for (int index = 0; index < areas.size(); ++index) {
+        if (areas.at(index).isValid()) {
+            order.append(index);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return qMakePair(flowKey(areas.at(a).topLeft()), a) < qMakePair(flowKey(areas.at(b).topLeft()), b);
+    });
+
+    int lanes = byColumn ? rows : columns;
+    FlowGrid grid(lanes, byColumn ? columns : rows);
+    if (reserved.x() >= 0 && reserved.x() < columns && reserved.y() >= 0 && (rows < 0 || reserved.y() < rows)) {
+        grid.take(toFrame(QRect(reserved, QSize(1, 1))));
+    }
+
+    QVector<QRect> flowed(areas.size());
+    bool keeping = start.x() >= 0 && start.y() >= 0;
+    int position = 0;
+    for (int index : qAsConst(order)) {
+        QRect framed = toFrame(areas.at(index));
+
+        if (keeping && flowKey(areas.at(index).topLeft()) < flowKey(start) && grid.fits(framed)) {
+            grid.take(framed);
+            flowed[index] = areas.at(index);
+            position = framed.top() * lanes + framed.left();
+            continue;
+        }
+        keeping = false;
+
+        QSize size = constrainedSpan(placedWidgets.value(index), areas.at(index).size(), true);
+        size = byColumn ? QSize(size.height(), size.width()) : size;
+        size.setWidth(qMin(size.width(), lanes));
+
+        int found = grid.find(size, dense ? 0 : position);
+        if (found < 0) {
+            return {};
+        }
+        framed = QRect(QPoint(found % lanes, found / lanes), size);
+        grid.take(framed);
+        flowed[index] = toFrame(framed);
+        position = found;
+    }
+    return flowed;
+}
+
+// Returns a value of the layout saved besides the placements, see LayoutValueKeys
+int QTileLayout::layoutValue(const QString &key) const {
+    if (key == QLatin1String("row_minimum_height")) {
+        return minVerticalSpan;
+    } else if (key == QLatin1String("column_minimum_width")) {
+        return minHorizontalSpan;
+    } else if (key == QLatin1String("row_height")) {
+        return verticalSpan;
+    } else if (key == QLatin1String("column_width")) {
+        return horizontalSpan;
+    } else if (key == QLatin1String("vertical_spacing")) {
+        return verticalGap;
+    } else if (key == QLatin1String("horizontal_spacing")) {
+        return horizontalGap;
+    } else if (key == QLatin1String("rows")) {
+        return rowNumber;
+    } else if (key == QLatin1String("columns")) {
+        return columnNumber;
+    }
+    return 0;
+}
+
+// Applies a value of a saved layout. The grid size is only kept in grid (width in columns,
+// height in rows) until the placements are built. Unknown keys are ignored
+void QTileLayout::applyLayoutValue(const QString &key, qint64 value, QSize &grid) {
+    int number = static_cast<int>(qBound<qint64>(0, value, std::numeric_limits<int>::max()));
+
+    if (key == QLatin1String("row_minimum_height")) {
+        setRowsMinimumHeight(number);
+    } else if (key == QLatin1String("column_minimum_width")) {
+        setColumnsMinimumWidth(number);
+    } else if (key == QLatin1String("row_height")) {
+        setRowsHeight(number);
+    } else if (key == QLatin1String("column_width")) {
+        setColumnsWidth(number);
+    } else if (key == QLatin1String("vertical_spacing")) {
+        setVerticalSpacing(number);
+    } else if (key == QLatin1String("horizontal_spacing")) {
+        setHorizontalSpacing(number);
+    } else if (key == QLatin1String("rows")) {
+        grid.setHeight(number);
+    } else if (key == QLatin1String("columns")) {
+        grid.setWidth(number);
+    }
+}
+
+// Keeps the current values, grid and placements in the build, to put them back if the load fails
+void QTileLayout::saveLayoutState(LayoutBuild &build) const {
+    for (const char *key : LayoutValueKeys) {
+        build.values.append(layoutValue(QLatin1String(key)));
+    }
+    build.grid = QSize(columnNumber, rowNumber);
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        build.arrangement.insert(placedWidgets.at(index), placedAreas.at(index));
+    }
+}
+
+// Empties the layout and gives it the grid of a layout being loaded, as the start of a single
+// operation that starts a new history. The widgets are looked up by name among the widgets of
+// the layout only: a document cannot bring in another widget of the parent widget. Returns
+// false, leaving the layout untouched, without a grid
+bool QTileLayout::beginLayoutBuild(LayoutBuild &build, const QSize &grid) {
+    if (grid.width() <= 0 || grid.height() <= 0) {
+        return false;
+    }
+
+    for (QWidget *widget : qAsConst(placedWidgets)) {
+        if (!widget->objectName().isEmpty()) {
+            build.widgets.insert(widget->objectName(), widget);
+        }
+    }
+
+    beginChange();
+    replaying = true;
+    holdOverlay = true;
+    clear();
+
+    rowNumber = grid.height();
+    columnNumber = grid.width();
+    createTileMap();
+    publishSnapshot();
+    invalidate();
+    build.started = true;
+    return true;
+}
+
+// Places a widget of a layout being loaded, if it is known, not placed yet and the area is free
+void QTileLayout::buildPlacement(LayoutBuild &build, const QString &name, const QRect &area) {
+    QWidget *widget = build.widgets.value(name);
+    if (!widget || build.placed.contains(widget) || !isAreaFree(area)) {
+        return;
+    }
+
+    build.placed.insert(widget);
+    insertTile(widget, area);
+    recordChange(widget, QRect(), area);
+}
+
+void QTileLayout::endLayoutBuild() {
+    replaying = false;
+    holdOverlay = false;
+    clearHistory();
+    if (overlay) {
+        overlay->updateCells();
+    }
+    endChange();
+}
+
+// Puts back the layout saved in the build after a failed load: the values, then the grid and
+// the placements if the build started, ending its operation. The history is kept
+void QTileLayout::restoreLayoutState(const LayoutBuild &build) {
+    QSize grid;
+    for (int index = 0; index < build.values.size(); ++index) {
+        applyLayoutValue(QLatin1String(LayoutValueKeys[index]), build.values.at(index), grid);
+    }
+    if (!build.started) {
+        return;
+    }
+
+    clear();
+    rowNumber = build.grid.height();
+    columnNumber = build.grid.width();
+    createTileMap();
+    applyArrangement(build.arrangement);
+    publishSnapshot();
+    invalidate();
+
+    replaying = false;
+    holdOverlay = false;
+    if (overlay) {
+        overlay->updateCells();
+    }
+    endChange();
+}
+
+// Adds a range of widths, from minimumWidth up to the next breakpoint, in which the layout has
+// the given number of columns. The widgets are reflowed the first time the range is entered if
+// its number of columns differs from the grid, and each range then keeps its own arrangement
+void QTileLayout::addBreakpoint(int minimumWidth, int columnNumber) {
+    if (columnNumber <= 0) {
+        return;
+    }
+
+    int position = 0;
+    while (position < breakpoints.size() && breakpoints.at(position).minimumWidth < minimumWidth) {
+        ++position;
+    }
+    if (position < breakpoints.size() && breakpoints.at(position).minimumWidth == minimumWidth) {
+        breakpoints[position].columnNumber = columnNumber;
+        breakpoints[position].arrangement.clear();
+        if (position == currentBreakpoint) {
+            switchBreakpoint(position);
+        }
+    } else {
+        breakpoints.insert(position, {minimumWidth, columnNumber, rowNumber, {}});
+        if (currentBreakpoint >= position) {
+            ++currentBreakpoint;
+        }
+    }
+
+    // The next relayout switches to the new breakpoint if the width falls in its range
+    invalidate();
+}
+
+// Stores the arrangement of the widgets for the breakpoint starting at minimumWidth. It is used
+// as is when the breakpoint is entered, if it places every widget of the layout without overlap
+void QTileLayout::setBreakpointArrangement(int minimumWidth, const QMap<QWidget*, QRect> &arrangement) {
+    for (int index = 0; index < breakpoints.size(); ++index) {
+        if (breakpoints.at(index).minimumWidth == minimumWidth) {
+            breakpoints[index].arrangement = arrangement;
+            if (index == currentBreakpoint) {
+                switchBreakpoint(index);
+            }
+            return;
+        }
+    }
+}
+
+// Removes the breakpoints, the layout keeps its current columns and arrangement
+void QTileLayout::clearBreakpoints() {
+    breakpoints.clear();
+    currentBreakpoint = -1;
+    invalidate();
+}
+
+// Returns the index of the breakpoint of the width: the widest one starting at or below it,
+// or the narrowest one if the width is below them all. -1 if there is no breakpoint
+int QTileLayout::breakpointFor(int width) const {
+    if (breakpoints.isEmpty()) {
+        return -1;
+    }
+
+    int index = 0;
+    while (index + 1 < breakpoints.size() && breakpoints.at(index + 1).minimumWidth <= width) {
+        ++index;
+    }
+    return index;
+}
+
+// Applies the arrangement of the breakpoint in a single pass: the grid is resized, each widget
+// gets its area from the table and the cells are indexed once. The previous breakpoint keeps
+// the arrangement it is left with. The undo history is cleared, its areas belong to another grid
+void QTileLayout::switchBreakpoint(int index) {
+    if (index < 0) {
+        currentBreakpoint = index;
+        return;
+    }
+
+    if (currentBreakpoint >= 0 && currentBreakpoint != index) {
+        Breakpoint &previous = breakpoints[currentBreakpoint];
+        previous.rowNumber = rowNumber;
+        previous.arrangement.clear();
+        for (int placed = 0; placed < placedWidgets.size(); ++placed) {
+            previous.arrangement.insert(placedWidgets.at(placed), placedAreas.at(placed));
+        }
+    }
+
+    Breakpoint &target = breakpoints[index];
+    currentBreakpoint = index;
+
+    // The stored arrangement is used if it covers every widget, without overlap
+    QVector<QRect> areas;
+    int rows = target.rowNumber;
+    for (const QRect &area : qAsConst(target.arrangement)) {
+        rows = qMax(rows, area.bottom() + 1);
+    }
+
+    tileMap.reset(rows, target.columnNumber, tileMap.isSparse());
+    for (QWidget *widget : qAsConst(placedWidgets)) {
+        QRect area = target.arrangement.value(widget);
+        if (!QRect(0, 0, target.columnNumber, rows).contains(area) || !tileMap.isFree(area)) {
+            areas.clear();
+            break;
+        }
+        tileMap.insert(widget, area);
+        areas.append(area);
+    }
+
+    // Otherwise the widgets keep their areas if the number of columns does not change (the
+    // breakpoint is entered for the first time, its arrangement starts from them), or are
+    // reflowed in the new columns
+    if (areas.size() != placedWidgets.size() && target.columnNumber == columnNumber) {
+        areas.clear();
+        for (const QRect &area : qAsConst(placedAreas)) {
+            areas.append(area);
+        }
+        rows = rowNumber;
+    } else if (areas.size() != placedWidgets.size()) {
+        areas = flowAreas(placedAreas, target.columnNumber, -1, QPoint(-1, -1));
+        rows = target.rowNumber;
+        for (const QRect &area : qAsConst(areas)) {
+            rows = qMax(rows, area.bottom() + 1);
+        }
+    }
+
+    beginChange();
+    replaying = true;
+    for (int placed = 0; placed < placedWidgets.size(); ++placed) {
+        if (areas.at(placed) != placedAreas.at(placed)) {
+            recordChange(placedWidgets.at(placed), placedAreas.at(placed), areas.at(placed));
+        }
+    }
+    replaying = false;
+
+    columnNumber = target.columnNumber;
+    rowNumber = rows;
+    for (int placed = 0; placed < placedWidgets.size(); ++placed) {
+        placedAreas[placed] = areas.at(placed);
+    }
+    createTileMap();
+    clearHistory();
+
+    if (overlay) {
+        overlay->updateCells();
+    }
+    endChange();
+
+    // The size hints follow the number of columns
+    invalidate();
+    emit breakpointChanged(target.minimumWidth, target.columnNumber);
+}
+
+// Routes the events of the parent widget: the hover moves over the whole grid, the mouse and
+// key events its children ignored, and the drag and drop events
+bool QTileLayout::eventFilter(QObject *watched, QEvent *event) {
+    if (watched != container) {
+        return QLayout::eventFilter(watched, event);
+    }
+
+    switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+        // The parent widget scrolled or changed size: other lazy widgets may be visible now
+        updateLazyWidgets();
+        break;
+    case QEvent::HoverMove:
+        hoverMoveEvent(static_cast<QHoverEvent*>(event));
+        break;
+    case QEvent::HoverLeave:
+        if (lock.isNull()) {
+            setContainerCursor(cursorIdle);
+        }
+        break;
+    case QEvent::MouseMove:
+        mouseMoveEvent(static_cast<QMouseEvent*>(event));
+        break;
+    case QEvent::MouseButtonPress:
+        mousePressEvent(static_cast<QMouseEvent*>(event));
+        break;
+    case QEvent::MouseButtonRelease:
+        mouseReleaseEvent(static_cast<QMouseEvent*>(event));
+        break;
+    // Only the drags of tiles are handled, the others go on to the parent widget
+    case QEvent::DragEnter:
+        if (!static_cast<QDropEvent*>(event)->mimeData()->hasFormat("TileData")) {
+            break;
+        }
+        dragEnterEvent(static_cast<QDragEnterEvent*>(event));
+        return true;
+    case QEvent::DragMove:
+        if (!static_cast<QDropEvent*>(event)->mimeData()->hasFormat("TileData")) {
+            break;
+        }
+        dragMoveEvent(static_cast<QDragMoveEvent*>(event));
+        return true;
+    case QEvent::DragLeave:
+        if (dragAndDrop) {
+            changeTilesColor("drag_and_drop");
+        }
+        break;
+    case QEvent::Drop:
+        if (!static_cast<QDropEvent*>(event)->mimeData()->hasFormat("TileData")) {
+            break;
+        }
+        dropEvent(static_cast<QDropEvent*>(event));
+        return true;
+    case QEvent::KeyPress:
+        keyPressEvent(static_cast<QKeyEvent*>(event));
+        return event->isAccepted();
+    default:
+        break;
+    }
+
+    return QLayout::eventFilter(watched, event);
+}
+
+// Actions to do when the mouse is moved
+void QTileLayout::mouseMoveEvent(QMouseEvent *event) {
+    if (rubberBand && rubberBand->isVisible()) {
+        rubberBand->setGeometry(QRect(rubberBandOrigin, event->pos()).normalized());
+        return;
+    }
+
+    if (event->buttons() == Qt::LeftButton) {
+        // Adjust offset from clicked point to origin of widget
+        if (pressedWidget && !mouseMovePos.isNull() && !dragInProcess && lock.isNull()) {
+            // Calculate the difference when moving the mouse
+            QPoint diff = event->pos() - mouseMovePos;
+
+            if (diff.manhattanLength() > 3) {
+                QPointer<QWidget> widget = pressedWidget;
+                if (dragAndDrop) {
+                    // A selected widget takes the rest of the selection along
+                    QList<QWidget*> group = selection();
+                    if (group.size() > 1 && group.contains(widget)) {
+                        QDrag *drag = prepareDropData(widget, mouseMovePos, group);
+                        groupDragProcess(drag, group);
+                    } else {
+                        QDrag *drag = prepareDropData(widget, mouseMovePos);
+                        dragAndDropProcess(drag, widget);
+                    }
+                    for (QTileLayout *layout : qAsConst(linkedLayout)) {
+                        layout->changeTilesColor("idle");
+                    }
+                    pressedWidget = nullptr;
+                    mouseMovePos = QPoint();
+                }
+                if (widget && focus) {
+                    widget->setFocus();
+                }
+                return;
+            }
+        }
+    }
+
+    if (!lock.isNull()) {
+        // highlight tiles that are going to be merged in the resizing
+        QPoint position = event->pos() - areaRect(pressedArea).topLeft();
+        int tileNumber = getResizeTileNumber(position.x(), position.y());
+
+        if (tileNumber != currentTileNumber) {
+            currentTileNumber = tileNumber;
+            changeTilesColor("resize");
+            highlightTiles(lock, pressedArea.top(), pressedArea.left(), tileNumber);
+        }
+    }
+}
+
+// Shows what a press would do at the mouse position: resize, grab or nothing
+void QTileLayout::hoverMoveEvent(QHoverEvent *event) {
+    // The cursor does not change while a widget is resized or dragged
+    if (!lock.isNull() || pressedWidget || dragInProcess) {
+        return;
+    }
+
+    QWidget *widget = placedWidgetAt(event->pos());
+    QPoint edge = widget ? resizeEdgeAt(widget, event->pos()) : QPoint();
+
+    if (!widget) {
+        setContainerCursor(cursorIdle);
+    } else if (edge.x() != 0) {
+        setContainerCursor(cursorResizeHorizontal);
+    } else if (edge.y() != 0) {
+        setContainerCursor(cursorResizeVertical);
+    } else if (dragAndDrop) {
+        setContainerCursor(cursorGrab);
+    } else {
+        setContainerCursor(cursorIdle);
+    }
+}
+
+// Actions to do when the mouse button is pressed
+void QTileLayout::mousePressEvent(QMouseEvent *event) {
+    QWidget *widget = placedWidgetAt(event->pos());
+    bool toggling = event->modifiers() & Qt::ControlModifier;
+
+    if (event->button() == Qt::LeftButton && widget && toggling && !dragInProcess) {
+        // Ctrl + click adds the widget to the selection, or takes it out
+        QList<QWidget*> widgets = selection();
+        if (!widgets.removeOne(widget)) {
+            widgets.append(widget);
+        }
+        setSelection(widgets);
+        pressedWidget = nullptr;
+        mouseMovePos = QPoint();
+    } else if (event->button() == Qt::LeftButton && !widget && !dragInProcess) {
+        // A press out of the widgets starts a rubber band selection
+        if (!toggling) {
+            clearSelection();
+        }
+        if (!rubberBand) {
+            rubberBand = new QRubberBand(QRubberBand::Rectangle, container);
+        }
+        rubberBandOrigin = event->pos();
+        rubberBand->setGeometry(QRect(rubberBandOrigin, QSize()));
+        rubberBand->show();
+        pressedWidget = nullptr;
+        mouseMovePos = QPoint();
+    } else if (event->button() == Qt::LeftButton && widget && !dragInProcess) {
+        if (!selection().contains(widget)) {
+            clearSelection();
+        }
+        pressedWidget = widget;
+        pressedArea = placementOf(widget);
+        mouseMovePos = event->pos();
+        lock = resizeEdgeAt(widget, event->pos());
+
+        if (!lock.isNull()) {
+            changeTilesColor("resize");
+            freezeWidgets();
+        }
+    } else {
+        pressedWidget = nullptr;
+        mouseMovePos = QPoint();
+    }
+}
+
+// Actions to do when the mouse button is released
+void QTileLayout::mouseReleaseEvent(QMouseEvent *event) {
+    if (rubberBand && rubberBand->isVisible()) {
+        // The widgets touched by the rubber band are selected, added to the selection with Ctrl
+        rubberBand->hide();
+        QList<QWidget*> widgets;
+        if (event->modifiers() & Qt::ControlModifier) {
+            widgets = selection();
+        }
+        forEachWidgetInRect(areaAt(rubberBand->geometry()), [&widgets](QWidget *widget, const QRect &) {
+            if (!widgets.contains(widget)) {
+                widgets.append(widget);
+            }
+        });
+        setSelection(widgets);
+    }
+
+    if (!lock.isNull()) {
+        QPoint position = event->pos() - areaRect(pressedArea).topLeft();
+        int tileNumber = getResizeTileNumber(position.x(), position.y());
+
+        resizeTile(lock, pressedArea.top(), pressedArea.left(), tileNumber);
+        changeTilesColor("idle");
+        currentTileNumber = 0;
+        lock = QPoint();
+        thawWidgets();
+    }
+
+    pressedWidget = nullptr;
+    mouseMovePos = QPoint();
+}
+
+// Reads the drag data once: the following moves only look the anchors up
+void QTileLayout::dragEnterEvent(QDragEnterEvent *event) {
+    if (dragAndDrop && event->mimeData()->hasFormat("TileData")) {
+        QJsonObject dragData = QJsonDocument::fromJson(event->mimeData()->data("TileData")).object();
+        dropGrab = QPoint(dragData["column_offset"].toInt(), dragData["row_offset"].toInt());
+
+        // A group keeps its shape: its areas are taken relative to the grabbed widget
+        dropFootprint.clear();
+        QPoint from(dragData["from_column"].toInt(), dragData["from_row"].toInt());
+        const QJsonArray members = dragData["group"].toArray();
+        for (const QJsonValue &value : members) {
+            QJsonObject member = value.toObject();
+            dropFootprint.append(QRect(
+                member["column"].toInt() - from.x(), member["row"].toInt() - from.y(),
+                member["column_span"].toInt(), member["row_span"].toInt()
+                ));
+        }
+
+        QSize span(dragData["column_span"].toInt(), dragData["row_span"].toInt());
+        if (span != dropSpan || dropAnchors.isEmpty()) {
+            prepareDropAnchors(span.height(), span.width());
+        }
+        event->acceptProposedAction();
+    } else {
+        event->ignore();
+    }
+}
+
+// Highlights where the widget would land, if it fits there
+void QTileLayout::dragMoveEvent(QDragMoveEvent *event) {
+    QPoint cell = dropCellAt(event->pos());
+    QPoint anchor = cell - dropGrab;
+
+    if (!dropFootprint.isEmpty()) {
+        if (dragAndDrop && cell.x() >= 0 && isFootprintFree(dropFootprint, anchor)) {
+            QRect bounds;
+            for (const QRect &area : qAsConst(dropFootprint)) {
+                bounds |= area.translated(anchor);
+            }
+            changeTilesColor("empty_check", QPoint(bounds.top(), bounds.left()), QPoint(bounds.height(), bounds.width()));
+            event->acceptProposedAction();
+        } else {
+            changeTilesColor("drag_and_drop");
+            event->ignore();
+        }
+        return;
+    }
+
+    if (dragAndDrop && cell.x() >= 0 && isDropAnchor(anchor.y(), anchor.x())) {
+        changeTilesColor("empty_check", QPoint(anchor.y(), anchor.x()), QPoint(dropSpan.height(), dropSpan.width()));
+        event->acceptProposedAction();
+    } else if (dragAndDrop && cell.x() >= 0 && pushing) {
+        // The widgets in the way may be pushed aside, which only the drop can tell
+        changeTilesColor("drag_and_drop");
+        event->acceptProposedAction();
+    } else {
+        changeTilesColor("drag_and_drop");
+        event->ignore();
+    }
+}
+
+void QTileLayout::dropEvent(QDropEvent *event) {
+    QJsonObject dropData = QJsonDocument::fromJson(event->mimeData()->data("TileData")).object();
+    QTileLayout *originTileLayout = linkedLayout.value(QUuid(dropData["id"].toString()));
+    QPoint cell = dropCellAt(event->pos());
+
+    if (dropData.contains("group")) {
+        // The whole group is placed in one operation, if its footprint is free
+        QPoint anchor = cell - QPoint(dropData["column_offset"].toInt(), dropData["row_offset"].toInt());
+        QList<QPointer<QWidget>> group = originTileLayout ? originTileLayout->groupToDrop : QList<QPointer<QWidget>>();
+        bool complete = group.size() == dropFootprint.size()
+            && std::all_of(group.begin(), group.end(), [](const QPointer<QWidget> &widget) { return !widget.isNull(); });
+
+        if (complete && cell.x() >= 0 && isFootprintFree(dropFootprint, anchor)) {
+            QPoint from(dropData["from_column"].toInt(), dropData["from_row"].toInt());
+            QVector<PlacementChange> changes;
+            for (int index = 0; index < group.size(); ++index) {
+                changes.append({group.at(index), QRect(), dropFootprint.at(index).translated(anchor)});
+            }
+            originTileLayout->groupToDrop.clear();
+            commitChanges(changes);
+            if (originTileLayout != this) {
+                originTileLayout->linkSteps(this);
+            }
+
+            for (int index = 0; index < changes.size(); ++index) {
+                QPoint previous = from + dropFootprint.at(index).topLeft();
+                emit tileMoved(
+                    changes.at(index).widget, dropData["id"].toString(), getId(),
+                    previous.y(), previous.x(), changes.at(index).to.top(), changes.at(index).to.left()
+                    );
+            }
+            event->acceptProposedAction();
+        } else {
+            event->ignore();
+        }
+        return;
+    }
+
+    QWidget *widget = originTileLayout ? originTileLayout->draggedWidget.data() : nullptr;
+
+    if (widget && cell.x() >= 0) {
+        QRect area(
+            cell.x() - dropData["column_offset"].toInt(), cell.y() - dropData["row_offset"].toInt(),
+            dropData["column_span"].toInt(), dropData["row_span"].toInt()
+            );
+
+        // The widgets in the way may be pushed along the main direction of the drag
+        QPoint delta(area.left() - dropData["from_column"].toInt(), area.top() - dropData["from_row"].toInt());
+        QPoint direction = qAbs(delta.x()) > qAbs(delta.y())
+            ? QPoint(delta.x() > 0 ? 1 : -1, 0)
+            : QPoint(0, delta.y() < 0 ? -1 : 1);
+
+        if (originTileLayout->transferWidget(widget, this, area, direction)) {
+            event->acceptProposedAction();
+            return;
+        }
+    }
+
+    // The drop is refused: the widget never left the origin layout
+    event->ignore();
+}
+
+// Moves (Ctrl + arrow), grows (Shift + arrow) or shrinks (Ctrl + Shift + arrow) the focused
+// widget from the keyboard: the key events it did not use come up to the parent widget
+void QTileLayout::keyPressEvent(QKeyEvent *event) {
+    QPoint direction;
+    switch (event->key()) {
+    case Qt::Key_Left:
+        direction = QPoint(-1, 0);
+        break;
+    case Qt::Key_Right:
+        direction = QPoint(1, 0);
+        break;
+    case Qt::Key_Up:
+        direction = QPoint(0, -1);
+        break;
+    case Qt::Key_Down:
+        direction = QPoint(0, 1);
+        break;
+    default:
+        break;
+    }
+
+    Qt::KeyboardModifiers modifiers = event->modifiers() & ~Qt::KeypadModifier;
+    QWidget *widget = placedWidgetOf(QApplication::focusWidget());
+    QRect area = placementOf(widget);
+
+    if (!widget || direction.isNull() || !lock.isNull() || dragInProcess) {
+        event->ignore();
+    } else if (modifiers == Qt::ControlModifier && dragAndDrop) {
+        moveTile(direction, area.top(), area.left());
+        event->accept();
+    } else if ((modifiers == Qt::ShiftModifier || modifiers == (Qt::ControlModifier | Qt::ShiftModifier)) && resizable) {
+        // The edge facing the arrow moves out to grow the widget, the opposite one moves in
+        // to shrink it: in both cases the edge moves along the arrow
+        QPoint edge = modifiers == Qt::ShiftModifier ? direction : -direction;
+        resizeTile(edge, area.top(), area.left(), direction.x() + direction.y());
+        event->accept();
+    } else {
+        event->ignore();
+    }
+}
+
+// Returns the placed widget that is or contains the given widget, nullptr if there is none
+QWidget* QTileLayout::placedWidgetOf(QWidget *widget) const {
+    while (widget && widget != container) {
+        if (placementIndex.contains(widget)) {
+            return widget;
+        }
+        widget = widget->parentWidget();
+    }
+    return nullptr;
+}
+
+// Returns the widget whose area contains the position of the parent widget, the spacings
+// between its cells included, nullptr if there is none
+QWidget* QTileLayout::placedWidgetAt(const QPoint &position) const {
+    QRect cell = areaAt(QRect(position, QSize(1, 1)));
+    QWidget *widget = cell.isEmpty() ? nullptr : widgetAt(cell.y(), cell.x());
+    return widget && areaRect(placementOf(widget)).contains(position) ? widget : nullptr;
+}
+
+// Returns the cell a drag at the position of the parent widget points to: the cell under it,
+// or the one before the spacing it is in. (-1, -1) out of the grid
+QPoint QTileLayout::dropCellAt(const QPoint &position) const {
+    QRect cell = areaAt(QRect(position, QSize(1, 1)));
+    return cell.isEmpty() ? QPoint(-1, -1) : cell.topLeft();
+}
+
+// Returns the edge of the widget the position is on, as a direction: (-1, 0) for west,
+// (1, 0) east, (0, -1) north and (0, 1) south. Null if it is not on an edge or resizing is off
+QPoint QTileLayout::resizeEdgeAt(QWidget *widget, const QPoint &position) const {
+    if (!resizable) {
+        return QPoint();
+    }
+
+    QRect rect = areaRect(placementOf(widget));
+    QPoint local = position - rect.topLeft();
+    if (local.x() < resizeMargin) {
+        return QPoint(-1, 0);
+    } else if (local.x() > rect.width() - resizeMargin) {
+        return QPoint(1, 0);
+    } else if (local.y() < resizeMargin) {
+        return QPoint(0, -1);
+    } else if (local.y() > rect.height() - resizeMargin) {
+        return QPoint(0, 1);
+    }
+    return QPoint();
+}
+
+// Sets the cursor of the parent widget, only when it changes
+void QTileLayout::setContainerCursor(Qt::CursorShape shape) {
+    if (container && shape != containerCursor) {
+        containerCursor = shape;
+        container->setCursor(QCursor(shape));
+    }
+}
+
+// Prepares data for the drag and drop process, position being where the widget was grabbed.
+// A group of widgets dragged along with it is described in the data, and shown in the pixmap
+QDrag *QTileLayout::prepareDropData(QWidget *widget, const QPoint &position, const QList<QWidget*> &group) {
+    QRect area = placementOf(widget);
+    QPoint grab = position - areaRect(area).topLeft();
+
+    QDrag *drag = new QDrag(container);
+    QMimeData *dropData = new QMimeData();
+    QJsonObject data;
+    data["id"] = getId(); // this is string than we convert it again in uuid
+    data["from_row"] = area.top();
+    data["from_column"] = area.left();
+    data["row_span"] = area.height();
+    data["column_span"] = area.width();
+    data["row_offset"] = grab.y() / (verticalSpan + verticalGap);
+    data["column_offset"] = grab.x() / (horizontalSpan + horizontalGap);
+
+    QRect bounds = area;
+    if (!group.isEmpty()) {
+        QJsonArray members;
+        for (QWidget *member : group) {
+            QRect memberArea = placementOf(member);
+            QJsonObject memberData;
+            memberData["row"] = memberArea.top();
+            memberData["column"] = memberArea.left();
+            memberData["row_span"] = memberArea.height();
+            memberData["column_span"] = memberArea.width();
+            members.append(memberData);
+            bounds |= memberArea;
+        }
+        data["group"] = members;
+    }
+
+    QByteArray dataBytes = QJsonDocument(data).toJson();
+    dropData->setData("TileData", dataBytes);
+
+    // The shadow is drawn on a snapshot: the widget itself gets no graphics effect, which
+    // would render it off screen and break the native and OpenGL widgets
+    CustomShadowEffect bodyShadow;
+    bodyShadow.setBlurRadius(20.0);
+    bodyShadow.setDistance(10.0);
+    bodyShadow.setColor(QColor(0, 0, 0, 80));
+    int margin = qCeil(bodyShadow.blurRadius() + bodyShadow.distance());
+
+    QRect pixels = areaRect(bounds);
+    QPixmap dragIcon = bodyShadow.shadowed(group.isEmpty() ? widget->grab() : container->grab(pixels));
+
+    drag->setPixmap(dragIcon);
+    drag->setMimeData(dropData);
+    drag->setHotSpot(position - pixels.topLeft() + QPoint(margin, margin));
+
+    return drag;
+}
+
+// Manages the drag and drop process. The widget stays in the layout, hidden, until the drop
+// transfers it: a cancelled or refused drag has nothing to put back
+void QTileLayout::dragAndDropProcess(QDrag *drag, QWidget *widget) {
+    dragInProcess = true;
+    QRect previousArea = placementOf(widget);
+
+    QPointer<QWidget> dragged = widget;
+    draggedWidget = widget;
+    widget->clearFocus();
+
+    // Every layout the widget can be dropped in records the whole drag as a single undo step
+    QList<QPointer<QTileLayout>> linkedLayouts;
+    for (QTileLayout *layout : qAsConst(linkedLayout)) {
+        layout->beginChange();
+        linkedLayouts.append(layout);
+    }
+
+    widget->hide();
+
+    // The places where the widget fits do not change until it is dropped
+    for (QTileLayout *layout : qAsConst(linkedLayout)) {
+        layout->prepareDropAnchors(previousArea.height(), previousArea.width());
+        if (layout->getDragAndDrop()) {
+            layout->changeTilesColor("drag_and_drop");
+        }
+        layout->freezeWidgets();
+    }
+
+    drag->exec();
+    draggedWidget = nullptr;
+
+    for (const QPointer<QTileLayout> &layout : qAsConst(linkedLayouts)) {
+        if (layout) {
+            layout->dropAnchors.clear();
+        }
+    }
+
+    // A widget dropped in another layout was shown by it
+    if (dragged && placementIndex.contains(dragged)) {
+        dragged->show();
+        if (focus) {
+            dragged->setFocus();
+        }
+    }
+
+    for (const QPointer<QTileLayout> &layout : qAsConst(linkedLayouts)) {
+        if (layout) {
+            layout->endChange();
+            layout->thawWidgets();
+        }
+    }
+
+    dragInProcess = false;
+}
+
+// Manages the drag and drop of a group of widgets: they leave the layout in one pass and are
+// placed as a rigid group by the layout they are dropped in, or put back where they were
+void QTileLayout::groupDragProcess(QDrag *drag, const QList<QWidget*> &group) {
+    dragInProcess = true;
+
+    QVector<QRect> previousAreas;
+    groupToDrop.clear();
+    for (QWidget *widget : group) {
+        previousAreas.append(placementOf(widget));
+        groupToDrop.append(widget);
+        widget->clearFocus();
+    }
+
+    // Every layout the group can be dropped in records the whole drag as a single undo step
+    QList<QPointer<QTileLayout>> linkedLayouts;
+    for (QTileLayout *layout : qAsConst(linkedLayout)) {
+        layout->beginChange();
+        linkedLayouts.append(layout);
+    }
+
+    removeWidgets(group);
+
+    for (QTileLayout *layout : qAsConst(linkedLayout)) {
+        if (layout->getDragAndDrop()) {
+            layout->changeTilesColor("drag_and_drop");
+        }
+        layout->freezeWidgets();
+    }
+
+    drag->exec();
+
+    if (!groupToDrop.isEmpty()) {
+        // The group has not been dropped: it goes back where it was
+        QVector<PlacementChange> changes;
+        for (int index = 0; index < groupToDrop.size(); ++index) {
+            if (groupToDrop.at(index)) {
+                changes.append({groupToDrop.at(index), QRect(), previousAreas.at(index)});
+            }
+        }
+        groupToDrop.clear();
+        commitChanges(changes);
+    }
+
+    for (const QPointer<QTileLayout> &layout : qAsConst(linkedLayouts)) {
+        if (layout) {
+            layout->dropFootprint.clear();
+            layout->endChange();
+            layout->thawWidgets();
+        }
+    }
+
+    dragInProcess = false;
+}
+
+// Checks if the footprint of a dragged group, moved to the anchor, is in the grid and empty
+bool QTileLayout::isFootprintFree(const QVector<QRect> &footprint, const QPoint &anchor) const {
+    QRect grid(0, 0, columnNumber, rowNumber);
+    for (const QRect &area : footprint) {
+        if (!grid.contains(area.translated(anchor))) {
+            return false;
+        }
+    }
+    return tileMap.isFree(footprint, anchor);
+}
+
+// Finds the cells where a widget of the given spans can be dropped: an anchor is valid if the
+// area starting there is in the grid and empty. A summed-area table of the occupied cells
+// gives the number of occupied cells of any area in constant time
+void QTileLayout::prepareDropAnchors(int rowSpan, int columnSpan) {
+    QVector<int> occupied((rowNumber + 1) * (columnNumber + 1), 0);
+    auto sum = [&occupied, this](int row, int column) -> int& {
+        return occupied[row * (columnNumber + 1) + column];
+    };
+
+    // The occupied cells are marked from the placements, which works in sparse mode as well.
+    // The cells of the widget being dragged out of this layout count as free
+    for (int index = 0; index < placedAreas.size(); ++index) {
+        if (placedWidgets.at(index) == draggedWidget) {
+            continue;
+        }
+        const QRect &area = placedAreas.at(index);
+        for (int row = area.top(); row <= area.bottom(); ++row) {
+            for (int column = area.left(); column <= area.right(); ++column) {
+                sum(row + 1, column + 1) = 1;
+            }
+        }
+    }
+
+    for (int row = 0; row < rowNumber; ++row) {
+        for (int column = 0; column < columnNumber; ++column) {
+            sum(row + 1, column + 1) += sum(row, column + 1) + sum(row + 1, column) - sum(row, column);
+        }
+    }
+
+    dropSpan = QSize(columnSpan, rowSpan);
+    dropAnchors.fill(false, rowNumber * columnNumber);
+    for (int row = 0; row + rowSpan <= rowNumber; ++row) {
+        for (int column = 0; column + columnSpan <= columnNumber; ++column) {
+            int count = sum(row + rowSpan, column + columnSpan) - sum(row, column + columnSpan)
+                - sum(row + rowSpan, column) + sum(row, column);
+            dropAnchors[row * columnNumber + column] = (count == 0);
+        }
+    }
+}
+
+// Checks if the dragged widget can be dropped with its top left corner on the cell
+bool QTileLayout::isDropAnchor(int row, int column) const {
+    if (row < 0 || row >= rowNumber || column < 0 || column >= columnNumber
+        || dropAnchors.size() != rowNumber * columnNumber) {
+        return false;
+    }
+    return dropAnchors.at(row * columnNumber + column);
+}
+
+// Finds the tile number when resizing, x and y being relative to the resized widget
+int QTileLayout::getResizeTileNumber(int x, int y) const {
+    if (lock.isNull()) {
+        return 0;
+    }
+
+    // The number is clamped to the span constraints before any highlight or resize is tried
+    int tileNumber = visitEdge(lock, [&](auto tag) {
+        constexpr Edge edge = decltype(tag)::value;
+        int span = horizontal<edge> ? horizontalSpan : verticalSpan;
+        int spacing = horizontal<edge> ? horizontalGap : verticalGap;
+        int position = horizontal<edge> ? x : y;
+
+        // The east and south edges are measured from the far side of the widget
+        if (outwards<edge> > 0) {
+            position -= span * (horizontal<edge> ? pressedArea.width() : pressedArea.height());
+        }
+        return (position + span / 2) / (span + spacing);
+    });
+    return clampedTileNumber(pressedWidget, lock, tileNumber);
+}
+
+// Checks if the spans, width in columns and height in rows, respect the widget constraints.
+// The aspect ratio holds if either span is the other one at the ratio, rounded
+bool QTileLayout::fitsConstraints(QWidget *widget, const QSize &span) const {
+    auto constraint = spanConstraints.constFind(widget);
+    if (constraint == spanConstraints.constEnd()) {
+        return true;
+    }
+
+    if ((constraint->minimum.isValid()
+         && (span.width() < constraint->minimum.width() || span.height() < constraint->minimum.height()))
+        || (constraint->maximum.isValid()
+            && (span.width() > constraint->maximum.width() || span.height() > constraint->maximum.height()))) {
+        return false;
+    }
+
+    qreal ratio = constraint->aspectRatio;
+    return ratio <= 0
+        || span.width() == qMax(1, qRound(span.height() * ratio))
+        || span.height() == qMax(1, qRound(span.width() / ratio));
+}
+
+// Brings the spans within the widget constraints. With an aspect ratio, the columns are kept
+// and the rows follow if keepColumns is true, the other way round otherwise
+QSize QTileLayout::constrainedSpan(QWidget *widget, QSize span, bool keepColumns) const {
+    auto constraint = spanConstraints.constFind(widget);
+    if (constraint == spanConstraints.constEnd()) {
+        return span;
+    }
+
+    auto bound = [&constraint](QSize size) {
+        if (constraint->maximum.isValid()) {
+            size = size.boundedTo(constraint->maximum);
+        }
+        if (constraint->minimum.isValid()) {
+            size = size.expandedTo(constraint->minimum);
+        }
+        return size;
+    };
+
+    span = bound(span);
+    if (constraint->aspectRatio > 0) {
+        if (keepColumns) {
+            span.setHeight(qMax(1, qRound(span.width() / constraint->aspectRatio)));
+        } else {
+            span.setWidth(qMax(1, qRound(span.height() * constraint->aspectRatio)));
+        }
+        span = bound(span);
+    }
+    return span;
+}
+
+// Applies the constraints of the widget to an area resized along the direction: with an aspect
+// ratio, the other span follows, from the top or left side. The area is refused, giving back
+// the current one, if it is still out of the constraints or does not find free cells
+QRect QTileLayout::constrainedArea(QWidget *widget, const QRect &area, QPoint direction) const {
+    QRect current = placementOf(widget);
+    if (area == current || !spanConstraints.contains(widget)) {
+        return area;
+    }
+
+    // The span along the direction is the one asked for, only the other one may follow
+    bool horizontalEdge = direction.x() != 0;
+    QRect constrained(area.topLeft(), constrainedSpan(widget, area.size(), horizontalEdge));
+    if ((horizontalEdge ? constrained.width() != area.width() : constrained.height() != area.height())
+        || !fitsConstraints(widget, constrained.size()) || !isAreaFree(constrained, widget)) {
+        return current;
+    }
+    return constrained;
+}
+
+// Brings a resize of the widget by tileNumber along the direction back towards no resize,
+// until the dragged span respects the widget constraints
+int QTileLayout::clampedTileNumber(QWidget *widget, QPoint direction, int tileNumber) const {
+    QRect area = placementOf(widget);
+    if (!area.isValid() || direction.isNull() || !spanConstraints.contains(widget)) {
+        return tileNumber;
+    }
+
+    bool horizontalEdge = direction.x() != 0;
+    int outward = direction.x() + direction.y();
+    for (int number = tileNumber; number != 0; number += (number > 0 ? -1 : 1)) {
+        int span = (horizontalEdge ? area.width() : area.height()) + number * outward;
+        if (span < 1) {
+            continue;
+        }
+        // The dragged span must hold as it is, the other one may follow the aspect ratio
+        QSize size = horizontalEdge ? QSize(span, area.height()) : QSize(area.width(), span);
+        QSize constrained = constrainedSpan(widget, size, horizontalEdge);
+        if ((horizontalEdge ? constrained.width() : constrained.height()) == span
+            && fitsConstraints(widget, constrained)) {
+            return number;
+        }
+    }
+    return 0;
 }
@@ -1,28 +1,79 @@
 #ifndef QTILELAYOUT_H
 #define QTILELAYOUT_H
 
-#include "tile.h"
+#include "lazytile.h"
+#include "tileindex.h"
+#include "tilejournal.h"
+#include "tilesnapshot.h"
+#include "tileoverlay.h"
 #include <QWidget>
-#include <QGridLayout>
+#include <QLayout>
+#include <QWidgetItem>
 #include <QUuid>
+#include <QHash>
+#include <QSet>
 #include <QPalette>
 #include <QResizeEvent>
 #include <QMouseEvent>
+#include <QHoverEvent>
+#include <QKeyEvent>
 #include <QDragEnterEvent>
 #include <QDragMoveEvent>
 #include <QDropEvent>
+#include <QMimeData>
+#include <QDrag>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRubberBand>
+#include <QUndoStack>
+#include <QIODevice>
+#include <memory>
+#include <atomic>
 
-class QTileLayout : public QGridLayout {
+// A grid of fixed size cells in which widgets are placed over rectangular areas of cells.
+// The geometry of the widgets is computed directly from their areas, the spans and the spacings
+class QTileLayout : public QLayout {
     Q_OBJECT
 
 public:
+    // What happens to the lazy widgets far out of the visible part of the layout
+    enum LazyPolicy {
+        KeepLazyWidgets,        // they stay as they are
+        HibernateLazyWidgets,   // they are hidden, keeping their state
+        DestroyLazyWidgets      // they are deleted, the factory creates them again if needed
+    };
+
+    // How the widgets are flowed back in the grid
+    enum AutoFlow {
+        RowFlow,                // row by row, each widget after the previous one
+        ColumnFlow,             // column by column, each widget after the previous one
+        DenseRowFlow,           // row by row, each widget in the first hole it fits in
+        DenseColumnFlow         // column by column, each widget in the first hole it fits in
+    };
+
     explicit QTileLayout(int rowNumber, int columnNumber, int verticalSpan, int horizontalSpan,
                 int verticalSpacing = 5, int horizontalSpacing = 5, QWidget *parent = nullptr);
+    ~QTileLayout();
 
     void addWidget(QWidget *widget, int fromRow, int fromColumn, int rowSpan = 1, int columnSpan = 1);
     void removeWidget(QWidget *widget);
+    LazyTile *addLazyWidget(LazyTile::Factory factory, int fromRow, int fromColumn, int rowSpan = 1, int columnSpan = 1);
+    void setPrefetchMargin(int pixels);
+    void setLazyPolicy(LazyPolicy policy, int releaseMargin = 2000);
+    QList<QWidget*> removeWidgets(const QList<QWidget*> &widgets, bool deleteWidgets = false);
+    QList<QWidget*> removeWidgetsInRect(const QRect &area, bool deleteWidgets = false);
+    QList<QWidget*> clear(bool deleteWidgets = false);
+    bool applyArrangement(const QMap<QWidget*, QRect> &arrangement);
+    bool applyArrangement(const QMap<QString, QRect> &arrangement);
+    bool exportLayout(QIODevice *device) const;
+    bool importLayout(QIODevice *device);
+    QByteArray exportLayoutJson() const;
+    bool importLayoutJson(const QByteArray &json);
     void acceptDragAndDrop(bool value);
     void acceptResizing(bool value);
+    void acceptPushing(bool value);
+    void setMaxPushChain(int length);
     void setCursorIdle(Qt::CursorShape value);
     void setCursorGrab(Qt::CursorShape value);
     void setCursorResizeHorizontal(Qt::CursorShape value);
@@ -31,33 +82,70 @@ public:
     void setColorResize(QColor color);
     void setColorDragAndDrop(QColor color);
     void setColorEmptyCheck(QColor color);
+    void setColorSelection(QColor color);
     int rowCount() const;
     int columnCount() const;
     QRect tileRect(int row, int column) const;
+    QRect areaRect(const QRect &area) const;
+    QPoint cellAt(const QPoint &position) const;
+    QRect areaAt(const QRect &rect) const;
     int rowsMinimumHeight() const;
     int columnsMinimumWidth() const;
     void setRowsMinimumHeight(int height);
     void setColumnsMinimumWidth(int width);
+    void setSpanConstraints(QWidget *widget, const QSize &minimumSpan, const QSize &maximumSpan = QSize(), qreal aspectRatio = 0);
+    void clearSpanConstraints(QWidget *widget);
     void setRowsHeight(int height);
     void setColumnsWidth(int width);
+    int verticalSpacing() const;
+    int horizontalSpacing() const;
     void setVerticalSpacing(int spacing);
     void setHorizontalSpacing(int spacing);
+    void setSparseGrid(bool sparse);
+    void addBreakpoint(int minimumWidth, int columnNumber);
+    void setBreakpointArrangement(int minimumWidth, const QMap<QWidget*, QRect> &arrangement);
+    void clearBreakpoints();
+    bool isSparseGrid() const;
     QString getId() const;
     void activateFocus(bool focus);
-    QList<QWidget*> widgetList() const;
+    void freezeUpdatesDuringInteraction(bool value);
+    const QList<QWidget*> &widgetList() const;
+    std::shared_ptr<const TileSnapshot> snapshot() const;
+    QWidget* widgetAt(int row, int column) const;
+    QRect placementOf(QWidget *widget) const;
+    QList<QWidget*> widgetsInRect(const QRect &area) const;
+    QList<QWidget*> selection() const;
+    void setSelection(const QList<QWidget*> &widgets);
+    void clearSelection();
+    template <typename Visitor> void forEachPlacement(Visitor visit) const;
+    template <typename Visitor> void forEachWidgetInRect(const QRect &area, Visitor visit) const;
     void linkLayout(QTileLayout *layout);
     void unLinkLayout(QTileLayout *layout);
     void highlightTiles(QPoint direction, int fromRow, int fromColumn, int tileNumber);
     void resizeTile(QPoint direction, int fromRow, int fromColumn, int tileNumber);
-    Tile* hardSplitTiles(int fromRow, int fromColumn, QList<QPoint> tilesToSplit);
+    void moveTile(QPoint direction, int fromRow, int fromColumn);
+    bool pushWidget(QWidget *widget, int fromRow, int fromColumn, int rowSpan, int columnSpan, QPoint direction);
+    bool moveWidget(QWidget *widget, int toRow, int toColumn);
+    bool resizeWidget(QWidget *widget, int rowSpan, int columnSpan);
+    bool swapWidgets(QWidget *widget, QWidget *other);
+    bool transferWidget(QWidget *widget, QTileLayout *target, const QRect &area, QPoint direction = QPoint());
+    void undo();
+    void redo();
+    bool canUndo() const;
+    bool canRedo() const;
+    void setJournalMemoryLimit(int bytes);
+    void setUndoStack(QUndoStack *stack);
+    void beginChange();
+    void endChange();
     bool isAreaEmpty(int fromRow, int fromColumn, int rowSpan, int columnSpan, QString color = "");
-    QWidget* getWidgetToDrop();
-    void setWidgetToDrop(QWidget *widget);
     void changeTilesColor(QString colorChoice, QPoint fromTile = QPoint(0, 0), QPoint toTile = QPoint());
     void reorderWidgets(const QByteArray &mimeData, int targetRow, int targetColumn);
+    void setAutoFlow(AutoFlow flow);
+    AutoFlow autoFlow() const;
 
     bool getDragAndDrop() const;
     bool getResizable() const;
+    bool getPushing() const;
     bool getFocus() const;
 
     Qt::CursorShape getCursorIdle() const;
@@ -65,9 +153,21 @@ public:
     Qt::CursorShape getCursorResizeHorizontal() const;
     Qt::CursorShape getCursorResizeVertical() const;
 
-    QMap<QUuid, QTileLayout *> getLinkedLayout() const;
+    const QMap<QUuid, QTileLayout *> &getLinkedLayout() const;
     void updateGlobalSize(QResizeEvent *newSize);
 
+    // QLayout
+    void addItem(QLayoutItem *item) override;
+    QLayoutItem *itemAt(int index) const override;
+    QLayoutItem *takeAt(int index) override;
+    int count() const override;
+    QSize sizeHint() const override;
+    QSize minimumSize() const override;
+    Qt::Orientations expandingDirections() const override;
+    void setGeometry(const QRect &rect) override;
+
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 public slots:
     void addRows(int rowNumber);
     void addColumns(int columnNumber);
@@ -77,48 +177,215 @@ public slots:
 signals:
     void tileResized(QWidget *widget, int fromRow, int fromColumn, int rowSpan, int columnSpan);
     void tileMoved(QWidget *widget, QString str, QString str2, int fromRow, int fromColumn, int rowSpan, int columnSpan);
+    void layoutChanged(const QVector<PlacementChange> &changes);
+    void breakpointChanged(int minimumWidth, int columnNumber);
+    void selectionChanged();
 
 protected:
+    void hoverMoveEvent(QHoverEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
     void mousePressEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
     void dragEnterEvent(QDragEnterEvent *event);
     void dragMoveEvent(QDragMoveEvent *event);
     void dropEvent(QDropEvent *event);
+    void keyPressEvent(QKeyEvent *event);
 
 private:
-    void mergeTiles(Tile *tile, int fromRow, int fromColumn, int rowSpan, int columnSpan, QList<QPoint> tilesToMerge);
-    void splitTiles(Tile *tile, int fromRow, int fromColumn, int rowSpan, int columnSpan, QList<QPoint> tilesToSplit);
-    Tile* createTile(int fromRow, int fromColumn, int rowSpan = 1, int columnSpan = 1, bool updateTileMap = false);
-    std::tuple<QList<QPoint>, bool, int, int, int, int> getTilesToBeResized(Tile* tile, QPoint direction, int fromRow, int fromColumn, int tileNumber);
-    std::tuple<int, QList<QPoint> > getTilesToSplit(QPoint direction, int fromRow, int fromColumn, int tileNumber);
-    std::tuple<int, QList<QPoint> > getTilesToMerge(QPoint direction, int fromRow, int fromColumn, int tileNumber);
+    struct LayoutBuild;
+
+    void attachParentWidget();
+    void placeTile(int index, const QRect &area);
+    bool isAreaFree(const QRect &area, QWidget *widget = nullptr) const;
+    bool relocateTile(QWidget *widget, const QRect &target);
+    void insertTile(QWidget *widget, const QRect &area);
+    QRect takeTile(QWidget *widget);
+    QList<QWidget*> takeTiles(const QVector<bool> &removed, bool deleteWidgets);
+    void recordChange(QWidget *widget, const QRect &from, const QRect &to);
+    void applyChanges(const QVector<PlacementChange> &changes, bool placementSignals);
+    void emitPlacementSignal(const PlacementChange &change);
+    void commitChanges(const QVector<PlacementChange> &changes, bool placementSignals = true);
+    bool canApplyChanges(const QVector<PlacementChange> &changes) const;
+    QRect grownArea(const QRect &area, QPoint direction, int tileNumber) const;
+    QRect resizedArea(QWidget *widget, QPoint direction, int tileNumber) const;
+    QVector<PlacementChange> planPush(QWidget *widget, const QRect &target, QPoint direction) const;
+    void linkSteps(QTileLayout *other);
+    void replayStep(bool forward);
+    QTileLayout *ownerOf(QWidget *widget) const;
+    void pushUndoCommand();
+    void clearHistory();
+    void flushChanges();
+    void publishSnapshot();
+    QWidget* placedWidgetOf(QWidget *widget) const;
+    QWidget* placedWidgetAt(const QPoint &position) const;
+    QPoint dropCellAt(const QPoint &position) const;
+    QPoint resizeEdgeAt(QWidget *widget, const QPoint &position) const;
+    void setContainerCursor(Qt::CursorShape shape);
+    QDrag *prepareDropData(QWidget *widget, const QPoint &position, const QList<QWidget*> &group = {});
+    void dragAndDropProcess(QDrag *drag, QWidget *widget);
+    void groupDragProcess(QDrag *drag, const QList<QWidget*> &group);
+    bool isFootprintFree(const QVector<QRect> &footprint, const QPoint &anchor) const;
+    int getResizeTileNumber(int x, int y) const;
+    bool fitsConstraints(QWidget *widget, const QSize &span) const;
+    QSize constrainedSpan(QWidget *widget, QSize span, bool keepColumns) const;
+    QRect constrainedArea(QWidget *widget, const QRect &area, QPoint direction) const;
+    int clampedTileNumber(QWidget *widget, QPoint direction, int tileNumber) const;
+
+    void prepareDropAnchors(int rowSpan, int columnSpan);
+    bool isDropAnchor(int row, int column) const;
+
+    void updateLazyWidgets();
+    void scheduleLazyUpdate();
+    QVector<QRect> flowAreas(const QList<QRect> &areas, int columns, int rows, const QPoint &reserved, const QPoint &start = QPoint(-1, -1)) const;
+    bool planReorder(const QList<QRect> &areas, const QPoint &reserved, QVector<PlacementChange> &changes) const;
+    bool flowsBefore(const QPoint &cell, const QPoint &other) const;
+    void markFlowDirty(const QRect &area);
+    void markFlowed(const QPoint &reserved);
+    int layoutValue(const QString &key) const;
+    void applyLayoutValue(const QString &key, qint64 value, QSize &grid);
+    void saveLayoutState(LayoutBuild &build) const;
+    bool beginLayoutBuild(LayoutBuild &build, const QSize &grid);
+    void buildPlacement(LayoutBuild &build, const QString &name, const QRect &area);
+    void endLayoutBuild();
+    void restoreLayoutState(const LayoutBuild &build);
+    int breakpointFor(int width) const;
+    void switchBreakpoint(int index);
+    void freezeWidgets();
+    void thawWidgets();
 
     void createTileMap();
-    void updateAllTiles();
 
 private:
+    // Spans a widget can be resized to, in cells: width in columns, height in rows. An invalid
+    // size or a null aspect ratio (columns over rows) leaves the spans free
+    struct SpanConstraint {
+        QSize minimum;
+        QSize maximum;
+        qreal aspectRatio;
+    };
+
+    // The widgets a layout being loaded can place, by object name, and those already placed
+    struct LayoutBuild {
+        QHash<QString, QWidget*> widgets;
+        QSet<QWidget*> placed;
+        bool started = false;
+
+        // The layout before the load, put back if the load fails
+        QVector<int> values;    // in the order of LayoutValueKeys
+        QSize grid;
+        QMap<QWidget*, QRect> arrangement;
+    };
+
+    // A range of widths starting at minimumWidth, with its own number of columns
+    // and its own arrangement of the widgets
+    struct Breakpoint {
+        int minimumWidth;
+        int columnNumber;
+        int rowNumber;
+        QMap<QWidget*, QRect> arrangement;
+    };
+
     int rowNumber;
     int columnNumber;
     int verticalSpan;
     int horizontalSpan;
     int minVerticalSpan;
     int minHorizontalSpan;
+    int verticalGap;        // space between two rows
+    int horizontalGap;      // space between two columns
     bool dragAndDrop;
     bool resizable;
     bool focus;
-    QWidget *widgetToDrop;
-    QList<QList<Tile*>> tileMap;
-    QMap<QString, QList<QWidget *>> widgetTileCouple;
+    bool pushing;
+    int maxPushChain;
+    QPointer<QWidget> draggedWidget;    // the widget of this layout being dragged
+    TileIndex tileMap;                  // the widget covering each cell
+    QList<QWidget*> placedWidgets;
+    QList<QRect> placedAreas;
+    QList<QWidgetItem*> placedItems;
+    QHash<QWidget*, int> placementIndex;    // the index of each placed widget in the lists above
     QMap<QUuid, QTileLayout*> linkedLayout;
     QUuid id;
     Qt::CursorShape cursorIdle;
     Qt::CursorShape cursorGrab;
     Qt::CursorShape cursorResizeHorizontal;
     Qt::CursorShape cursorResizeVertical;
+    Qt::CursorShape containerCursor;    // the cursor last set on the parent widget
     QMap<QString, QColor> colorMap;
+    QPointer<TileOverlay> overlay;
+    QPointer<QWidget> container;
+    TileJournal journal;
+    QPointer<QUndoStack> undoStack;
+    QPointer<QObject> history;          // shared by the commands pushed since the history was cleared
+    bool replaying;
+    bool takingTile;                    // the layout takes its own tiles, takeAt() is not called by Qt
+    bool holdOverlay;                   // a layout build updates the overlay once, at its end
+    QVector<PlacementChange> pendingChanges;
+    QHash<QWidget*, int> pendingIndex;  // the index of the pending change of each widget
+    int changeDepth;
+    std::atomic<const std::shared_ptr<const TileSnapshot>*> publishedSnapshot;  // only replaced by the GUI thread
+    mutable std::atomic<int> snapshotReaders;   // readers between loading publishedSnapshot and copying it
+    QVector<const std::shared_ptr<const TileSnapshot>*> retiredSnapshots;   // deleted once no reader is left
+
+    // Lazy widgets, in pixels around the visible part of the parent widget
+    QList<QPointer<LazyTile>> lazyTiles;
+    int prefetchMargin;
+    LazyPolicy lazyPolicy;
+    int releaseMargin;
+    bool lazyUpdateScheduled;
+
+    QMap<QWidget*, SpanConstraint> spanConstraints;
+    AutoFlow flowMode;
+    QPoint flowDirty;       // the first cell, in flow order, changed since the last flow, (-1, -1) if none
+    QPoint flowReserved;    // the cell the last flow left free, (-1, -1) if none
+
+    QVector<Breakpoint> breakpoints;    // sorted by minimum width
+    int currentBreakpoint;              // index in breakpoints, -1 before the first one applies
+
+    // Drag and drop, fixed for the whole drag
+    QVector<bool> dropAnchors;      // the top left cells where the dragged widget fits
+    QSize dropSpan;                 // the spans of the dragged widget: width in columns, height in rows
+    QPoint dropGrab;                // the cell of the dragged widget that was grabbed
+    QVector<QRect> dropFootprint;   // the areas of a dragged group, relative to the grabbed widget
+    QList<QPointer<QWidget>> groupToDrop;
+
+    // Selection
+    QList<QPointer<QWidget>> selectedWidgets;
+    QPointer<QRubberBand> rubberBand;
+    QPoint rubberBandOrigin;
+
+    // Mouse interaction, in the parent widget coordinates
+    int resizeMargin;
+    QPointer<QWidget> pressedWidget;
+    QRect pressedArea;
+    QPoint mouseMovePos;
+    QPoint lock;
+    bool dragInProcess;
+    int currentTileNumber;
+    bool freezeUpdates;
+    QList<QPointer<QWidget>> frozenWidgets;     // the widgets whose updates were turned off
 
 static QList<QVariant> flattenList(const QList<QList<QVariant>>& toFlatten);
 };
 
+// Calls visit(widget, area) for each widget of the layout, without copying anything
+template <typename Visitor>
+void QTileLayout::forEachPlacement(Visitor visit) const {
+    for (int index = 0; index < placedWidgets.size(); ++index) {
+        visit(placedWidgets.at(index), placedAreas.at(index));
+    }
+}
+
+// Calls visit(widget, area) once for each widget covering at least one cell of the area.
+// Only the cells of the area (its buckets in sparse mode) are scanned
+template <typename Visitor>
+void QTileLayout::forEachWidgetInRect(const QRect &area, Visitor visit) const {
+    QRect cells = area & QRect(0, 0, columnNumber, rowNumber);
+    if (!cells.isEmpty()) {
+        tileMap.forEachWidgetIn(cells, [this, &visit](QWidget *widget) {
+            visit(widget, placementOf(widget));
+        });
+    }
+}
+
 #endif // QTILELAYOUT_H
@@ -0,0 +1,146 @@
+#include "tileindex.h"
+
+TileIndex::TileIndex()
+    : rowNumber(0), columnNumber(0), sparse(false), bucketColumns(0)
+{
+}
+
+// Empties the index and gives it the size of the grid
+void TileIndex::reset(int rowNumber, int columnNumber, bool sparse) {
+    this->rowNumber = rowNumber;
+    this->columnNumber = columnNumber;
+    this->sparse = sparse;
+
+    cells.clear();
+    buckets.clear();
+    bucketColumns = 0;
+
+    if (sparse) {
+        bucketColumns = (columnNumber + BucketSize - 1) / BucketSize;
+        buckets.resize(bucketColumns * ((rowNumber + BucketSize - 1) / BucketSize));
+    } else {
+        cells.fill(nullptr, rowNumber * columnNumber);
+    }
+}
+
+bool TileIndex::isSparse() const {
+    return sparse;
+}
+
+// Marks the cells of the area as covered by the widget
+void TileIndex::insert(QWidget *widget, const QRect &area) {
+    if (!sparse) {
+        for (int row = area.top(); row <= area.bottom(); ++row) {
+            for (int column = area.left(); column <= area.right(); ++column) {
+                cells[row * columnNumber + column] = widget;
+            }
+        }
+        return;
+    }
+
+    QRect range = bucketsOf(area);
+    for (int bucketRow = range.top(); bucketRow <= range.bottom(); ++bucketRow) {
+        for (int bucketColumn = range.left(); bucketColumn <= range.right(); ++bucketColumn) {
+            buckets[bucketIndex(bucketRow, bucketColumn)].append({widget, area});
+        }
+    }
+}
+
+// Marks the cells of the area, covered by the widget, as empty
+void TileIndex::remove(QWidget *widget, const QRect &area) {
+    if (!sparse) {
+        for (int row = area.top(); row <= area.bottom(); ++row) {
+            for (int column = area.left(); column <= area.right(); ++column) {
+                // The cells may already have been given to another widget
+                if (cells.at(row * columnNumber + column) == widget) {
+                    cells[row * columnNumber + column] = nullptr;
+                }
+            }
+        }
+        return;
+    }
+
+    QRect range = bucketsOf(area);
+    for (int bucketRow = range.top(); bucketRow <= range.bottom(); ++bucketRow) {
+        for (int bucketColumn = range.left(); bucketColumn <= range.right(); ++bucketColumn) {
+            QVector<Entry> &bucket = buckets[bucketIndex(bucketRow, bucketColumn)];
+            for (int index = 0; index < bucket.size(); ++index) {
+                if (bucket.at(index).widget == widget && bucket.at(index).area == area) {
+                    // The order in a bucket does not matter
+                    bucket[index] = bucket.last();
+                    bucket.removeLast();
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Returns the widget covering the cell, nullptr if the cell is empty or out of the grid
+QWidget *TileIndex::widgetAt(int row, int column) const {
+    if (row < 0 || row >= rowNumber || column < 0 || column >= columnNumber) {
+        return nullptr;
+    }
+
+    if (!sparse) {
+        return cells.at(row * columnNumber + column);
+    }
+
+    for (const Entry &entry : buckets.at(bucketIndex(row / BucketSize, column / BucketSize))) {
+        if (entry.area.contains(column, row)) {
+            return entry.widget;
+        }
+    }
+    return nullptr;
+}
+
+// Checks if the area, which must lie in the grid, only covers empty cells or cells of the
+// ignored widget
+bool TileIndex::isFree(const QRect &area, QWidget *ignored) const {
+    if (!sparse) {
+        for (int row = area.top(); row <= area.bottom(); ++row) {
+            for (int column = area.left(); column <= area.right(); ++column) {
+                QWidget *widget = cells.at(row * columnNumber + column);
+                if (widget && widget != ignored) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    QRect range = bucketsOf(area);
+    for (int bucketRow = range.top(); bucketRow <= range.bottom(); ++bucketRow) {
+        for (int bucketColumn = range.left(); bucketColumn <= range.right(); ++bucketColumn) {
+            for (const Entry &entry : buckets.at(bucketIndex(bucketRow, bucketColumn))) {
+                if (entry.widget != ignored && entry.area.intersects(area)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Checks if all the areas moved by offset, which must lie in the grid, only cover empty cells:
+// the footprint of a group of widgets is checked in a single query
+bool TileIndex::isFree(const QVector<QRect> &areas, const QPoint &offset) const {
+    for (const QRect &area : areas) {
+        if (!isFree(area.translated(offset))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the buckets an area of cells lies on: x is the bucket column, y the bucket row
+QRect TileIndex::bucketsOf(const QRect &area) const {
+    return QRect(
+        QPoint(area.left() / BucketSize, area.top() / BucketSize),
+        QPoint(area.right() / BucketSize, area.bottom() / BucketSize)
+        );
+}
+
+int TileIndex::bucketIndex(int bucketRow, int bucketColumn) const {
+    return bucketRow * bucketColumns + bucketColumn;
+}
@@ -0,0 +1,83 @@
+#ifndef TILEINDEX_H
+#define TILEINDEX_H
+
+#include <QWidget>
+#include <QRect>
+#include <QVector>
+
+// Occupancy of the cells of a tile layout: which widget covers each cell.
+// The dense mode stores one pointer per cell. The sparse mode only stores the placed areas,
+// in square buckets of cells, so that memory and queries scale with the number of
+// placements rather than with the grid area. Rects are in cells: x is the column, y the row
+class TileIndex {
+
+public:
+    TileIndex();
+
+    void reset(int rowNumber, int columnNumber, bool sparse);
+    bool isSparse() const;
+
+    void insert(QWidget *widget, const QRect &area);
+    void remove(QWidget *widget, const QRect &area);
+
+    QWidget *widgetAt(int row, int column) const;
+    bool isFree(const QRect &area, QWidget *ignored = nullptr) const;
+    bool isFree(const QVector<QRect> &areas, const QPoint &offset = QPoint()) const;
+    template <typename Visitor> void forEachWidgetIn(const QRect &area, Visitor visit) const;
+
+private:
+    struct Entry {
+        QWidget *widget;
+        QRect area;
+    };
+
+    static const int BucketSize = 16;   // cells on each side of a bucket
+
+    QRect bucketsOf(const QRect &area) const;
+    int bucketIndex(int bucketRow, int bucketColumn) const;
+
+    int rowNumber;
+    int columnNumber;
+    bool sparse;
+    QVector<QWidget*> cells;            // dense mode, row by row
+    int bucketColumns;
+    QVector<QVector<Entry>> buckets;    // sparse mode, row by row
+};
+
+// Calls visit(widget) once for each widget covering at least one cell of the area,
+// which must lie in the grid
+template <typename Visitor>
+void TileIndex::forEachWidgetIn(const QRect &area, Visitor visit) const {
+    if (!sparse) {
+        // A widget is visited at its first cell in the area: the one with no cell of the
+        // same widget above or on its left
+        for (int row = area.top(); row <= area.bottom(); ++row) {
+            for (int column = area.left(); column <= area.right(); ++column) {
+                QWidget *widget = cells.at(row * columnNumber + column);
+                if (widget
+                    && (row == area.top() || cells.at((row - 1) * columnNumber + column) != widget)
+                    && (column == area.left() || cells.at(row * columnNumber + column - 1) != widget)) {
+                    visit(widget);
+                }
+            }
+        }
+        return;
+    }
+
+    // A widget is visited in the bucket holding the top left cell of its part of the area
+    QRect range = bucketsOf(area);
+    for (int bucketRow = range.top(); bucketRow <= range.bottom(); ++bucketRow) {
+        for (int bucketColumn = range.left(); bucketColumn <= range.right(); ++bucketColumn) {
+            for (const Entry &entry : buckets.at(bucketIndex(bucketRow, bucketColumn))) {
+                QRect common = entry.area & area;
+                if (!common.isEmpty()
+                    && common.top() / BucketSize == bucketRow
+                    && common.left() / BucketSize == bucketColumn) {
+                    visit(entry.widget);
+                }
+            }
+        }
+    }
+}
+
+#endif // TILEINDEX_H
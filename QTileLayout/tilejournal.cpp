@@ -0,0 +1,280 @@
+#include "tilejournal.h"
+
+// The journal keeps as many changes as fit in memoryLimit bytes
+TileJournal::TileJournal(int memoryLimit)
+    : memory(0), first(0), count(0), applied(0), depth(0), stepStart(0), overflowed(false), openLink(0)
+{
+    setMemoryLimit(memoryLimit);
+}
+
+// Changes the memory cap, the oldest steps are forgotten if they do not fit anymore
+void TileJournal::setMemoryLimit(int bytes) {
+    memory = qMax(0, bytes);
+    int capacity = memory / static_cast<int>(sizeof(Entry));
+
+    while (count > capacity) {
+        if (depth > 0 && stepStart == 0) {
+            dropOpenStep();
+        } else {
+            dropOldestStep();
+        }
+    }
+
+    QVector<Entry> resized(capacity);
+    for (int index = 0; index < count; ++index) {
+        resized[index] = entry(index);
+    }
+    ring = resized;
+    first = 0;
+}
+
+int TileJournal::memoryLimit() const {
+    return memory;
+}
+
+// Forgets the whole history
+void TileJournal::clear() {
+    for (Entry &item : ring) {
+        item = Entry();
+    }
+    first = 0;
+    count = 0;
+    applied = 0;
+    stepStart = 0;
+    overflowed = false;
+}
+
+// Starts a step: the changes recorded until endStep() are undone and redone together
+void TileJournal::beginStep() {
+    if (depth++ == 0) {
+        stepStart = applied;
+    }
+}
+
+// Ends a step, returns true if the step has been kept in the history
+bool TileJournal::endStep() {
+    if (depth == 0 || --depth > 0) {
+        return false;
+    }
+    openLink = 0;
+    if (overflowed) {
+        overflowed = false;
+        return false;
+    }
+    if (applied == stepStart) {
+        return false;
+    }
+
+    // A step that ends where it started (a cancelled drag for instance) is not kept
+    for (int index = stepStart; index < count; ++index) {
+        if (entry(index).from != entry(index).to) {
+            return true;
+        }
+    }
+
+    count = stepStart;
+    applied = stepStart;
+    return false;
+}
+
+bool TileJournal::isStepOpen() const {
+    return depth > 0;
+}
+
+// Records a change, returns true if it completes a step of its own. Inside a step,
+// successive changes of the same widget are merged into a single one
+bool TileJournal::record(QWidget *widget, const QRect &from, const QRect &to) {
+    if (ring.isEmpty() || overflowed) {
+        return false;
+    }
+
+    // A new change makes the undone steps unreachable
+    count = applied;
+
+    if (depth > 0) {
+        for (int index = stepStart; index < count; ++index) {
+            Entry &item = entry(index);
+            if (item.widget == widget) {
+                item.to = to;
+                return false;
+            }
+        }
+    }
+
+    if (count == ring.size()) {
+        // The open step is never truncated: if it fills the whole ring, it is dropped
+        if (depth > 0 && stepStart == 0) {
+            dropOpenStep();
+            return false;
+        }
+        dropOldestStep();
+    }
+
+    Entry &item = entry(count);
+    item.widget = widget;
+    item.from = from;
+    item.to = to;
+    item.chained = depth > 0 && count > stepStart;
+    item.link = depth > 0 ? openLink : 0;
+    ++count;
+    applied = count;
+
+    return depth == 0;
+}
+
+// Links the open step with the steps other journals record for the same operation (a widget
+// moved from a layout to another): they are meant to be undone and redone together
+void TileJournal::linkStep(quint64 link) {
+    if (depth == 0) {
+        return;
+    }
+    openLink = link;
+    for (int index = stepStart; index < count; ++index) {
+        entry(index).link = link;
+    }
+}
+
+// Returns the links of the steps in the history
+QSet<quint64> TileJournal::links() const {
+    QSet<quint64> found;
+    for (int index = 0; index < count; ++index) {
+        if (entry(index).link) {
+            found.insert(entry(index).link);
+        }
+    }
+    return found;
+}
+
+// Forgets the steps with one of the links, which cannot be replayed anymore (the other journal
+// is gone), with the steps that cannot be reached without them: the applied ones before, the
+// undone ones after. Returns true if a step was forgotten
+bool TileJournal::forgetLinks(const QSet<quint64> &links) {
+    int size = count;
+    for (int index = applied; index < count; ++index) {
+        if (links.contains(entry(index).link)) {
+            count = index;
+            break;
+        }
+    }
+
+    int last = applied - 1;
+    while (last >= 0 && !links.contains(entry(last).link)) {
+        --last;
+    }
+    int kept = applied - last - 1;
+    while (applied > kept) {
+        dropOldestStep();
+    }
+    return count != size;
+}
+
+bool TileJournal::canUndo() const {
+    return applied > 0;
+}
+
+bool TileJournal::canRedo() const {
+    return applied < count;
+}
+
+// The link of the last applied step, 0 if it is not linked
+quint64 TileJournal::undoLink() const {
+    return applied > 0 ? entry(applied - 1).link : 0;
+}
+
+// The link of the next undone step, 0 if it is not linked
+quint64 TileJournal::redoLink() const {
+    return applied < count ? entry(applied).link : 0;
+}
+
+// Returns the changes that revert the last applied step, in the order to apply them
+QVector<PlacementChange> TileJournal::undoChanges() const {
+    QVector<PlacementChange> changes;
+    int length = undoLength();
+    for (int index = applied - 1; index >= applied - length; --index) {
+        const Entry &item = entry(index);
+        if (item.widget) {
+            changes.append({item.widget, item.to, item.from});
+        }
+    }
+    return changes;
+}
+
+// Returns the changes of the next undone step, in the order to apply them
+QVector<PlacementChange> TileJournal::redoChanges() const {
+    QVector<PlacementChange> changes;
+    int length = redoLength();
+    for (int index = applied; index < applied + length; ++index) {
+        const Entry &item = entry(index);
+        if (item.widget) {
+            changes.append({item.widget, item.from, item.to});
+        }
+    }
+    return changes;
+}
+
+// Reverts the last applied step, returns its changes
+QVector<PlacementChange> TileJournal::undoStep() {
+    QVector<PlacementChange> changes = undoChanges();
+    applied -= undoLength();
+    return changes;
+}
+
+// Applies again the next undone step, returns its changes
+QVector<PlacementChange> TileJournal::redoStep() {
+    QVector<PlacementChange> changes = redoChanges();
+    applied += redoLength();
+    return changes;
+}
+
+TileJournal::Entry &TileJournal::entry(int index) {
+    return ring[(first + index) % ring.size()];
+}
+
+const TileJournal::Entry &TileJournal::entry(int index) const {
+    return ring[(first + index) % ring.size()];
+}
+
+// Number of entries of the last applied step
+int TileJournal::undoLength() const {
+    int length = 0;
+    while (length < applied) {
+        ++length;
+        if (!entry(applied - length).chained) {
+            break;
+        }
+    }
+    return length;
+}
+
+// Number of entries of the next undone step
+int TileJournal::redoLength() const {
+    int length = 0;
+    while (applied + length < count) {
+        ++length;
+        if (applied + length == count || !entry(applied + length).chained) {
+            break;
+        }
+    }
+    return length;
+}
+
+// Forgets the oldest step to make room in the ring, it is never the open step
+void TileJournal::dropOldestStep() {
+    int dropped = 0;
+    do {
+        entry(0) = Entry();
+        first = (first + 1) % ring.size();
+        --count;
+        ++dropped;
+    } while (count > 0 && entry(0).chained);
+
+    applied = qMax(0, applied - dropped);
+    stepStart = qMax(0, stepStart - dropped);
+}
+
+// Forgets the open step, which does not fit in the ring, with the whole history before it.
+// The changes recorded until the end of the step are ignored
+void TileJournal::dropOpenStep() {
+    clear();
+    overflowed = true;
+}
@@ -0,0 +1,64 @@
+#ifndef TILEJOURNAL_H
+#define TILEJOURNAL_H
+
+#include "placementchange.h"
+#include <QPointer>
+#include <QVector>
+#include <QSet>
+
+// Undo/redo history of a tile layout: a ring buffer of placement changes with a memory cap.
+// Changes recorded between beginStep() and endStep() are undone and redone together
+class TileJournal {
+
+public:
+    explicit TileJournal(int memoryLimit = 64 * 1024);
+
+    void setMemoryLimit(int bytes);
+    int memoryLimit() const;
+    void clear();
+
+    void beginStep();
+    bool endStep();
+    bool isStepOpen() const;
+    bool record(QWidget *widget, const QRect &from, const QRect &to);
+    void linkStep(quint64 link);
+    QSet<quint64> links() const;
+    bool forgetLinks(const QSet<quint64> &links);
+
+    bool canUndo() const;
+    bool canRedo() const;
+    quint64 undoLink() const;
+    quint64 redoLink() const;
+    QVector<PlacementChange> undoChanges() const;
+    QVector<PlacementChange> redoChanges() const;
+    QVector<PlacementChange> undoStep();
+    QVector<PlacementChange> redoStep();
+
+private:
+    struct Entry {
+        QPointer<QWidget> widget;
+        QRect from;
+        QRect to;
+        bool chained = false;   // belongs to the same step as the previous entry
+        quint64 link = 0;       // shared with the steps other journals recorded for the same operation
+    };
+
+    Entry &entry(int index);
+    const Entry &entry(int index) const;
+    int undoLength() const;
+    int redoLength() const;
+    void dropOldestStep();
+    void dropOpenStep();
+
+    QVector<Entry> ring;
+    int memory;
+    int first;      // ring index of the oldest entry
+    int count;      // number of entries in the ring
+    int applied;    // number of entries currently applied, the others can be redone
+    int depth;
+    int stepStart;
+    bool overflowed;    // the open step did not fit in the ring and has been dropped
+    quint64 openLink;
+};
+
+#endif // TILEJOURNAL_H
@@ -0,0 +1,233 @@
+#include "tileminimap.h"
+#include "qtilelayout.h"
+#include <QPainter>
+#include <QScrollArea>
+#include <algorithm>
+
+// The minimap follows the placements of the layout from its notifications, and the visible
+// part of the layout from the events of its parent widget
+TileMinimap::TileMinimap(QTileLayout *tileLayout, QWidget *parent)
+    : QWidget(parent), tileLayout(tileLayout),
+    emptyColor(235, 235, 235), viewportColor(40, 90, 200)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setCursor(Qt::PointingHandCursor);
+
+    if (tileLayout) {
+        connect(tileLayout, &QTileLayout::layoutChanged, this, &TileMinimap::applyChanges);
+        connect(tileLayout, &QTileLayout::breakpointChanged, this, [this](int, int) {
+            rebuild();
+            update();
+        });
+        watchContainer();
+        rebuild();
+    }
+}
+
+void TileMinimap::setEmptyColor(const QColor &color) {
+    if (color != emptyColor) {
+        emptyColor = color;
+        rebuild();
+        update();
+    }
+}
+
+void TileMinimap::setViewportColor(const QColor &color) {
+    if (color != viewportColor) {
+        viewportColor = color;
+        update(viewport.adjusted(-1, -1, 1, 1));
+    }
+}
+
+// A fixed width, with the proportions of the grid
+QSize TileMinimap::sizeHint() const {
+    QSize grid = gridSize();
+    return QSize(200, qBound(20, 200 * grid.height() / grid.width(), 400));
+}
+
+// Scrolling moves the parent widget of the layout, resizing the scroll area resizes its viewport
+bool TileMinimap::eventFilter(QObject *watched, QEvent *event) {
+    switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+        updateViewport();
+        break;
+    default:
+        break;
+    }
+
+    return QWidget::eventFilter(watched, event);
+}
+
+// Draws the cached image scaled to the widget, then the frame of the visible part
+void TileMinimap::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    if (!tileLayout) {
+        return;
+    }
+
+    // Rows and columns added or removed do not go through the change notifications
+    watchContainer();
+    if (cells.size() != gridSize()) {
+        rebuild();
+    }
+
+    qreal factor = scale();
+    painter.drawImage(QRectF(0, 0, cells.width() * factor, cells.height() * factor), cells);
+
+    viewport = viewportGeometry();
+    if (viewport.isValid()) {
+        painter.setPen(viewportColor);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(viewport.adjusted(0, 0, -1, -1));
+    }
+}
+
+void TileMinimap::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) {
+        scrollTo(event->pos());
+    }
+}
+
+// Dragging over the minimap keeps scrolling
+void TileMinimap::mouseMoveEvent(QMouseEvent *event) {
+    if (event->buttons() & Qt::LeftButton) {
+        scrollTo(event->pos());
+    }
+}
+
+// Watches the parent widget of the layout, once the layout is set on it
+void TileMinimap::watchContainer() {
+    if (container || !tileLayout || !tileLayout->parentWidget()) {
+        return;
+    }
+
+    container = tileLayout->parentWidget();
+    container->installEventFilter(this);
+    if (container->parentWidget()) {
+        container->parentWidget()->installEventFilter(this);
+    }
+}
+
+QSize TileMinimap::gridSize() const {
+    if (!tileLayout) {
+        return QSize(1, 1);
+    }
+    return QSize(qMax(1, tileLayout->columnCount()), qMax(1, tileLayout->rowCount()));
+}
+
+// Draws the image again from all the placements
+void TileMinimap::rebuild() {
+    cells = QImage(gridSize(), QImage::Format_RGB32);
+    cells.fill(emptyColor.rgb());
+
+    if (tileLayout) {
+        tileLayout->forEachPlacement([this](QWidget *widget, const QRect &area) {
+            fillCells(area, colorOf(widget));
+        });
+    }
+}
+
+// Draws the changed placements only: the areas left are all cleared before the new ones are
+// filled, since a widget can move into the cells another one left in the same operation
+void TileMinimap::applyChanges(const QVector<PlacementChange> &changes) {
+    if (cells.size() != gridSize()) {
+        rebuild();
+        update();
+        return;
+    }
+
+    QRgb empty = emptyColor.rgb();
+    for (const PlacementChange &change : changes) {
+        fillCells(change.from, empty);
+    }
+    for (const PlacementChange &change : changes) {
+        fillCells(change.to, colorOf(change.widget));
+    }
+
+    qreal factor = scale();
+    for (const PlacementChange &change : changes) {
+        QRect area = change.from | change.to;
+        QRectF scaled(area.left() * factor, area.top() * factor, area.width() * factor, area.height() * factor);
+        update(scaled.toAlignedRect().adjusted(-1, -1, 1, 1));
+    }
+}
+
+// Fills the pixels of the cells of the area, a null area is ignored
+void TileMinimap::fillCells(const QRect &area, QRgb color) {
+    QRect bounds = area & cells.rect();
+    for (int row = bounds.top(); row <= bounds.bottom(); ++row) {
+        QRgb *line = reinterpret_cast<QRgb*>(cells.scanLine(row));
+        std::fill(line + bounds.left(), line + bounds.right() + 1, color);
+    }
+}
+
+// Each widget gets its own hue, so that neighbours stay apart
+QRgb TileMinimap::colorOf(const QWidget *widget) const {
+    return QColor::fromHsv(static_cast<int>(qHash(widget) % 360), 80, 210).rgb();
+}
+
+// Pixels of the minimap for one cell: the whole grid fits in the widget
+qreal TileMinimap::scale() const {
+    if (cells.isNull()) {
+        return 1;
+    }
+    return qMin(qreal(width()) / cells.width(), qreal(height()) / cells.height());
+}
+
+// Returns the visible part of the layout, in the minimap coordinates
+QRect TileMinimap::viewportGeometry() const {
+    if (!tileLayout || !container || cells.isNull()) {
+        return QRect();
+    }
+
+    QRect grid = tileLayout->areaRect(QRect(0, 0, tileLayout->columnCount(), tileLayout->rowCount()));
+    QRect visible = container->visibleRegion().boundingRect() & grid;
+    if (visible.isEmpty()) {
+        return QRect();
+    }
+
+    qreal factorX = scale() * cells.width() / grid.width();
+    qreal factorY = scale() * cells.height() / grid.height();
+    return QRectF(
+        (visible.left() - grid.left()) * factorX, (visible.top() - grid.top()) * factorY,
+        visible.width() * factorX, visible.height() * factorY
+        ).toAlignedRect();
+}
+
+// Paints the frame of the visible part again if it moved
+void TileMinimap::updateViewport() {
+    QRect next = viewportGeometry();
+    if (next != viewport) {
+        update(viewport.adjusted(-1, -1, 1, 1));
+        update(next.adjusted(-1, -1, 1, 1));
+        viewport = next;
+    }
+}
+
+// Centres the scroll area holding the parent widget of the layout on the point of the minimap
+void TileMinimap::scrollTo(const QPoint &position) {
+    if (!tileLayout || !container || !container->parentWidget() || cells.isNull()) {
+        return;
+    }
+
+    // The parent widget of the layout lies in the viewport of the scroll area
+    QScrollArea *scrollArea = qobject_cast<QScrollArea*>(container->parentWidget()->parentWidget());
+    if (!scrollArea || scrollArea->widget() != container) {
+        return;
+    }
+
+    QRect grid = tileLayout->areaRect(QRect(0, 0, tileLayout->columnCount(), tileLayout->rowCount()));
+    qreal factor = scale();
+    QPoint target(
+        grid.left() + qRound(position.x() / factor * grid.width() / cells.width()),
+        grid.top() + qRound(position.y() / factor * grid.height() / cells.height())
+        );
+
+    QWidget *scrollViewport = scrollArea->viewport();
+    scrollArea->ensureVisible(target.x(), target.y(), scrollViewport->width() / 2, scrollViewport->height() / 2);
+}
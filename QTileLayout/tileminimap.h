@@ -0,0 +1,56 @@
+#ifndef TILEMINIMAP_H
+#define TILEMINIMAP_H
+
+#include "placementchange.h"
+#include <QWidget>
+#include <QPointer>
+#include <QColor>
+#include <QImage>
+#include <QPaintEvent>
+#include <QMouseEvent>
+
+class QTileLayout;
+
+// Overview of a whole tile layout: each cell is a pixel of a cached image, scaled to the
+// widget, with the placements in colour and a frame on the visible part of the layout.
+// The image is drawn from the placements and updated from the layoutChanged notifications,
+// the widgets of the layout are never grabbed. Pressing the minimap scrolls the enclosing
+// scroll area to the pressed point
+class TileMinimap : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit TileMinimap(QTileLayout *tileLayout, QWidget *parent = nullptr);
+
+    void setEmptyColor(const QColor &color);
+    void setViewportColor(const QColor &color);
+
+    QSize sizeHint() const override;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    void watchContainer();
+    QSize gridSize() const;
+    void rebuild();
+    void applyChanges(const QVector<PlacementChange> &changes);
+    void fillCells(const QRect &area, QRgb color);
+    QRgb colorOf(const QWidget *widget) const;
+    qreal scale() const;
+    QRect viewportGeometry() const;
+    void updateViewport();
+    void scrollTo(const QPoint &position);
+
+    QPointer<QTileLayout> tileLayout;
+    QPointer<QWidget> container;        // the parent widget of the layout
+    QImage cells;                       // one pixel for each cell
+    QColor emptyColor;
+    QColor viewportColor;
+    QRect viewport;                     // the frame last painted, in the minimap coordinates
+};
+
+#endif // TILEMINIMAP_H
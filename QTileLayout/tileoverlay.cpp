@@ -0,0 +1,114 @@
+#include "tileoverlay.h"
+#include "qtilelayout.h"
+#include <QPainter>
+
+// The overlay lies under the tiles and lets the mouse events through
+TileOverlay::TileOverlay(QTileLayout *tileLayout, QWidget *parent)
+    : QWidget(parent), tileLayout(tileLayout)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFocusPolicy(Qt::NoFocus);
+}
+
+void TileOverlay::setIdleColor(const QColor &color) {
+    if (color != idleColor) {
+        idleColor = color;
+        update();
+    }
+}
+
+// Colours every empty cell, and removes the highlight
+void TileOverlay::setBaseColor(const QColor &color) {
+    if (color != baseColor) {
+        baseColor = color;
+        highlight = QRect();
+        update();
+    } else if (!highlight.isNull()) {
+        updateCells(highlight);
+        highlight = QRect();
+    }
+}
+
+// Colours the empty cells of an area over the base colour, only the cells entering or
+// leaving the highlight are painted again
+void TileOverlay::setHighlight(const QRect &cells, const QColor &color) {
+    if (cells == highlight && color == highlightColor) {
+        return;
+    }
+
+    if (color != highlightColor) {
+        updateCells(highlight | cells);
+    } else {
+        for (const QRect &changed : (QRegion(highlight) ^ QRegion(cells))) {
+            updateCells(changed);
+        }
+    }
+    highlight = cells;
+    highlightColor = color;
+}
+
+void TileOverlay::setSelectionColor(const QColor &color) {
+    if (color != selectionColor) {
+        selectionColor = color;
+        update();
+    }
+}
+
+// Schedules the painting of the cells, the whole grid if no cell is given. The frame of a
+// selected widget around the cells is included
+void TileOverlay::updateCells(const QRect &cells) {
+    if (cells.isNull()) {
+        update();
+    } else {
+        update(cellsGeometry(cells).adjusted(-SelectionFrame, -SelectionFrame, SelectionFrame, SelectionFrame));
+    }
+}
+
+void TileOverlay::paintEvent(QPaintEvent *event) {
+    if (!tileLayout) {
+        return;
+    }
+
+    QRect cells = tileLayout->areaAt(event->rect().translated(pos()));
+    if (!cells.isValid()) {
+        return;
+    }
+
+    QPainter painter(this);
+
+    for (int row = cells.top(); row <= cells.bottom(); ++row) {
+        for (int column = cells.left(); column <= cells.right(); ++column) {
+            QWidget *widget = tileLayout->widgetAt(row, column);
+            if (!widget || widget->isHidden()) {
+                QRect cell(column, row, 1, 1);
+                painter.fillRect(cellsGeometry(cell), highlight.contains(column, row) ? highlightColor : baseColor);
+            }
+        }
+    }
+
+    // The cells of a hidden widget, being dragged, look empty
+    tileLayout->forEachWidgetInRect(cells, [this, &painter](QWidget *widget, const QRect &area) {
+        if (!widget->isHidden()) {
+            painter.fillRect(cellsGeometry(area), idleColor);
+        }
+    });
+
+    // The frame shows in the spacing around the selected widgets
+    for (QWidget *widget : tileLayout->selection()) {
+        QRect frame = cellsGeometry(tileLayout->placementOf(widget))
+            .adjusted(-SelectionFrame, -SelectionFrame, SelectionFrame, SelectionFrame);
+        if (frame.isValid() && frame.intersects(event->rect())) {
+            painter.fillRect(frame, selectionColor);
+        }
+    }
+}
+
+// Returns the pixel geometry of an area of cells, in the overlay coordinates
+QRect TileOverlay::cellsGeometry(const QRect &cells) const {
+    QRect bounds = cells & QRect(0, 0, tileLayout->columnCount(), tileLayout->rowCount());
+    if (bounds.isEmpty()) {
+        return QRect();
+    }
+
+    return tileLayout->areaRect(bounds).translated(-pos());
+}
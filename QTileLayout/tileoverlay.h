@@ -0,0 +1,42 @@
+#ifndef TILEOVERLAY_H
+#define TILEOVERLAY_H
+
+#include <QWidget>
+#include <QPointer>
+#include <QColor>
+#include <QPaintEvent>
+
+class QTileLayout;
+
+// Paints the grid of a tile layout behind its widgets: the empty cells in the base colour,
+// the highlighted cells in the highlight colour, the cells covered by a widget in the idle
+// colour and a frame around the selected widgets. Only the invalidated region is painted again
+class TileOverlay : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit TileOverlay(QTileLayout *tileLayout, QWidget *parent = nullptr);
+
+    void setIdleColor(const QColor &color);
+    void setBaseColor(const QColor &color);
+    void setHighlight(const QRect &cells, const QColor &color);
+    void setSelectionColor(const QColor &color);
+    void updateCells(const QRect &cells = QRect());
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    static const int SelectionFrame = 3;    // pixels around a selected widget
+
+    QRect cellsGeometry(const QRect &cells) const;
+
+    QPointer<QTileLayout> tileLayout;
+    QColor idleColor;
+    QColor baseColor;
+    QColor highlightColor;
+    QColor selectionColor;
+    QRect highlight;
+};
+
+#endif // TILEOVERLAY_H
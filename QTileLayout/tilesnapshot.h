@@ -0,0 +1,25 @@
+#ifndef TILESNAPSHOT_H
+#define TILESNAPSHOT_H
+
+#include <QWidget>
+#include <QRect>
+#include <QString>
+#include <QVector>
+
+// An immutable copy of the placements of a tile layout, published after each operation and
+// safe to read from any thread. The widget pointers only identify the widgets: they must not
+// be dereferenced out of the GUI thread
+struct TileSnapshot {
+    struct Placement {
+        const QWidget *widget = nullptr;
+        QString name;       // object name of the widget when the snapshot was taken
+        QRect area;         // in cells: x is the column, y the row
+    };
+
+    quint64 version = 0;    // increases with each published snapshot
+    int rowCount = 0;
+    int columnCount = 0;
+    QVector<Placement> placements;
+};
+
+#endif // TILESNAPSHOT_H